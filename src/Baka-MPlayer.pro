@@ -5,39 +5,23 @@
 #-------------------------------------------------
 
 VERSION   = 2.0.4
-QT       += core gui network svg
 CODECFORSRC = UTF-8
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
 TARGET = baka-mplayer
 TEMPLATE = app
 
-CONFIG += c++11 link_pkgconfig
-
 DESTDIR = build
 OBJECTS_DIR = $${DESTDIR}/obj
 MOC_DIR = $${DESTDIR}/moc
 RCC_DIR = $${DESTDIR}/rcc
 UI_DIR = $${DESTDIR}/ui
 
+include(baka.pri)
+
 macx {
-  QT_CONFIG -= no-pkg-config
-  SOURCES += platform/osx.cpp
   ICON = img/logo.icns
 }
 
-unix:!macx {
-    QT += x11extras
-    PKGCONFIG += x11
-
-    SOURCES += platform/linux.cpp
-}
-
-PKGCONFIG += mpv
-
 win32 {
-    QT += winextras
-    PKGCONFIG += libzip
-
     # mxe fix:
     CONFIG -= windows
     QMAKE_LFLAGS += $$QMAKE_LFLAGS_WINDOWS -pthread
@@ -52,13 +36,7 @@ win32 {
     QMAKE_TARGET_DESCRIPTION += Baka MPlayer
     #RC_LANG +=
 
-    SOURCES += platform/win.cpp
     RESOURCES += win_rsclist.qrc
-
-    # 32 bit
-    contains(QMAKE_HOST.arch, x86): SOURCES += platform/win32.cpp
-    # 64 bit
-    contains(QMAKE_HOST.arch, x86_64): SOURCES += platform/win64.cpp
 }
 
 # INSTROOT is the installation root directory, leave empty if not using a package management system
@@ -89,8 +67,6 @@ license.files = ../LICENSE
 
 INSTALLS += target icon logo desktop manual man license
 
-RESOURCES += rsclist.qrc
-
 isEmpty(TRANSLATIONS) {
     include(translations.pri)
 }
@@ -146,73 +122,4 @@ DEFINES += "BAKA_MPLAYER_VERSION=\\\"$$VERSION\\\"" \
            "BAKA_MPLAYER_LANG_PATH=\\\"$$BAKA_LANG_PATH\\\""
 !isEmpty(BAKA_LANG):DEFINES += "BAKA_MPLAYER_LANG=\\\"$$BAKA_LANG\\\""
 
-SOURCES += main.cpp\
-    bakaengine.cpp \
-    bakacommands.cpp \
-    mpvhandler.cpp \
-    updatemanager.cpp \
-    gesturehandler.cpp \
-    overlayhandler.cpp \
-    util.cpp \
-    settings.cpp \
-    versions/2_0_3.cpp \
-    widgets/customlabel.cpp \
-    widgets/customlineedit.cpp \
-    widgets/customslider.cpp \
-    widgets/customsplitter.cpp \
-    widgets/dimdialog.cpp \
-    widgets/indexbutton.cpp \
-    widgets/openbutton.cpp \
-    widgets/playlistwidget.cpp \
-    widgets/seekbar.cpp \
-    ui/aboutdialog.cpp \
-    ui/inputdialog.cpp \
-    ui/jumpdialog.cpp \
-    ui/locationdialog.cpp \
-    ui/mainwindow.cpp \
-    ui/preferencesdialog.cpp \
-    ui/screenshotdialog.cpp \
-    ui/updatedialog.cpp \
-    ui/keydialog.cpp \
-    overlay.cpp
-
-HEADERS  += \
-    bakaengine.h \
-    mpvhandler.h \
-    mpvtypes.h \
-    updatemanager.h \
-    gesturehandler.h \
-    overlayhandler.h \
-    overlay.h \
-    util.h \
-    settings.h \
-    widgets/customlabel.h \
-    widgets/customlineedit.h \
-    widgets/customslider.h \
-    widgets/customsplitter.h \
-    widgets/dimdialog.h \
-    widgets/indexbutton.h \
-    widgets/openbutton.h \
-    widgets/playlistwidget.h \
-    widgets/seekbar.h \
-    ui/aboutdialog.h \
-    ui/inputdialog.h \
-    ui/jumpdialog.h \
-    ui/locationdialog.h \
-    ui/mainwindow.h \
-    ui/preferencesdialog.h \
-    ui/screenshotdialog.h \
-    ui/updatedialog.h \
-    ui/keydialog.h \
-    recent.h
-
-FORMS    += \
-    ui/aboutdialog.ui \
-    ui/inputdialog.ui \
-    ui/jumpdialog.ui \
-    ui/locationdialog.ui \
-    ui/mainwindow.ui \
-    ui/preferencesdialog.ui \
-    ui/screenshotdialog.ui \
-    ui/updatedialog.ui \
-    ui/keydialog.ui
+SOURCES += main.cpp
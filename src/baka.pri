@@ -0,0 +1,144 @@
+# what the player is built from; shared by Baka-MPlayer.pro and benchmarks/benchmarks.pro
+
+QT       += core gui network svg
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets
+
+CONFIG += c++11 link_pkgconfig
+
+INCLUDEPATH += $$PWD
+
+macx {
+  QT_CONFIG -= no-pkg-config
+  SOURCES += $$PWD/platform/osx.cpp
+}
+
+unix:!macx {
+    QT += x11extras
+    PKGCONFIG += x11
+
+    SOURCES += $$PWD/platform/linux.cpp
+}
+
+PKGCONFIG += mpv
+
+win32 {
+    QT += winextras
+    PKGCONFIG += libzip
+
+    SOURCES += $$PWD/platform/win.cpp
+
+    # 32 bit
+    contains(QMAKE_HOST.arch, x86): SOURCES += $$PWD/platform/win32.cpp
+    # 64 bit
+    contains(QMAKE_HOST.arch, x86_64): SOURCES += $$PWD/platform/win64.cpp
+}
+
+RESOURCES += $$PWD/rsclist.qrc
+
+# scoped tracing (BAKA_TRACE) for `baka trace`; compiled out otherwise
+CONFIG(tracing):DEFINES += BAKA_TRACING
+
+SOURCES += \
+    $$PWD/bakaengine.cpp \
+    $$PWD/bakacommands.cpp \
+    $$PWD/mpvhandler.cpp \
+    $$PWD/mpvclient.cpp \
+    $$PWD/fakempv.cpp \
+    $$PWD/recording.cpp \
+    $$PWD/replay.cpp \
+    $$PWD/updatemanager.cpp \
+    $$PWD/gesturehandler.cpp \
+    $$PWD/overlayhandler.cpp \
+    $$PWD/thumbnailhandler.cpp \
+    $$PWD/waveformhandler.cpp \
+    $$PWD/logbuffer.cpp \
+    $$PWD/logfile.cpp \
+    $$PWD/watchhistory.cpp \
+    $$PWD/sessionjournal.cpp \
+    $$PWD/tracing.cpp \
+    $$PWD/watchdog.cpp \
+    $$PWD/benchmark.cpp \
+    $$PWD/singleinstance.cpp \
+    $$PWD/controlserver.cpp \
+    $$PWD/script.cpp \
+    $$PWD/headless.cpp \
+    $$PWD/util.cpp \
+    $$PWD/settings.cpp \
+    $$PWD/versions/2_0_3.cpp \
+    $$PWD/widgets/customlabel.cpp \
+    $$PWD/widgets/customlineedit.cpp \
+    $$PWD/widgets/customslider.cpp \
+    $$PWD/widgets/customsplitter.cpp \
+    $$PWD/widgets/dimdialog.cpp \
+    $$PWD/widgets/indexbutton.cpp \
+    $$PWD/widgets/openbutton.cpp \
+    $$PWD/widgets/playlistwidget.cpp \
+    $$PWD/widgets/seekbar.cpp \
+    $$PWD/ui/aboutdialog.cpp \
+    $$PWD/ui/inputdialog.cpp \
+    $$PWD/ui/jumpdialog.cpp \
+    $$PWD/ui/locationdialog.cpp \
+    $$PWD/ui/mainwindow.cpp \
+    $$PWD/ui/preferencesdialog.cpp \
+    $$PWD/ui/screenshotdialog.cpp \
+    $$PWD/ui/updatedialog.cpp \
+    $$PWD/ui/keydialog.cpp \
+    $$PWD/overlay.cpp
+
+HEADERS  += \
+    $$PWD/bakaengine.h \
+    $$PWD/mpvhandler.h \
+    $$PWD/mpvclient.h \
+    $$PWD/fakempv.h \
+    $$PWD/recording.h \
+    $$PWD/replay.h \
+    $$PWD/mpvtypes.h \
+    $$PWD/updatemanager.h \
+    $$PWD/gesturehandler.h \
+    $$PWD/overlayhandler.h \
+    $$PWD/thumbnailhandler.h \
+    $$PWD/waveformhandler.h \
+    $$PWD/logbuffer.h \
+    $$PWD/logfile.h \
+    $$PWD/watchhistory.h \
+    $$PWD/sessionjournal.h \
+    $$PWD/tracing.h \
+    $$PWD/watchdog.h \
+    $$PWD/benchmark.h \
+    $$PWD/singleinstance.h \
+    $$PWD/controlserver.h \
+    $$PWD/script.h \
+    $$PWD/headless.h \
+    $$PWD/overlay.h \
+    $$PWD/util.h \
+    $$PWD/settings.h \
+    $$PWD/widgets/customlabel.h \
+    $$PWD/widgets/customlineedit.h \
+    $$PWD/widgets/customslider.h \
+    $$PWD/widgets/customsplitter.h \
+    $$PWD/widgets/dimdialog.h \
+    $$PWD/widgets/indexbutton.h \
+    $$PWD/widgets/openbutton.h \
+    $$PWD/widgets/playlistwidget.h \
+    $$PWD/widgets/seekbar.h \
+    $$PWD/ui/aboutdialog.h \
+    $$PWD/ui/inputdialog.h \
+    $$PWD/ui/jumpdialog.h \
+    $$PWD/ui/locationdialog.h \
+    $$PWD/ui/mainwindow.h \
+    $$PWD/ui/preferencesdialog.h \
+    $$PWD/ui/screenshotdialog.h \
+    $$PWD/ui/updatedialog.h \
+    $$PWD/ui/keydialog.h \
+    $$PWD/recent.h
+
+FORMS    += \
+    $$PWD/ui/aboutdialog.ui \
+    $$PWD/ui/inputdialog.ui \
+    $$PWD/ui/jumpdialog.ui \
+    $$PWD/ui/locationdialog.ui \
+    $$PWD/ui/mainwindow.ui \
+    $$PWD/ui/preferencesdialog.ui \
+    $$PWD/ui/screenshotdialog.ui \
+    $$PWD/ui/updatedialog.ui \
+    $$PWD/ui/keydialog.ui
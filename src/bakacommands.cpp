@@ -9,6 +9,8 @@
 #include <QClipboard>
 #include <QMessageBox>
 
+#include <algorithm> // for std::sort
+
 #include "ui/mainwindow.h"
 #include "ui_mainwindow.h"
 #include "ui/aboutdialog.h"
@@ -20,6 +22,11 @@
 #include "widgets/dimdialog.h"
 #include "mpvhandler.h"
 #include "overlayhandler.h"
+#include "logfile.h"
+#include "controlserver.h"
+#include "script.h"
+#include "tracing.h"
+#include "watchdog.h"
 #include "updatemanager.h"
 #include "util.h"
 
@@ -58,7 +65,7 @@ void BakaEngine::BakaSh(QStringList &args)
 void BakaEngine::BakaNew(QStringList &args)
 {
     if(args.empty())
-        QProcess::startDetached(QApplication::applicationFilePath(), {});
+        QProcess::startDetached(QApplication::applicationFilePath(), {"--new-instance"});
     else
         InvalidParameter(args.join(' '));
 }
@@ -187,6 +194,14 @@ void BakaEngine::BakaStop(QStringList &args)
         InvalidParameter(args.join(' '));
 }
 
+void BakaEngine::BakaRewind(QStringList &args)
+{
+    if(args.empty())
+        mpv->Rewind();
+    else
+        InvalidParameter(args.join(' '));
+}
+
 void BakaEngine::BakaPlaylist(QStringList &args)
 {
     if(!args.empty())
@@ -308,7 +323,7 @@ void BakaEngine::Jump()
 
 void BakaEngine::BakaDim(QStringList &args)
 {
-    if(dimDialog == nullptr)
+    if(getDimDialog() == nullptr)
     {
         Print(tr("DimDialog not supported on this platform"));
         return;
@@ -321,7 +336,7 @@ void BakaEngine::BakaDim(QStringList &args)
 
 void BakaEngine::Dim(bool dim)
 {
-    if(dimDialog == nullptr)
+    if(getDimDialog() == nullptr)
     {
         QMessageBox::information(window, tr("Dim Lights"), tr("In order to dim the lights, the desktop compositor has to be enabled. This can be done through Window Manager Desktop."));
         return;
@@ -427,7 +442,16 @@ void BakaEngine::FitWindow(int percent, bool msg)
     if(window->isFullScreen() || window->isMaximized() || !window->ui->menuFit_Window->isEnabled())
         return;
 
-    mpv->LoadVideoParams();
+    mpv->LoadVideoParams([=]
+                         {
+                             FitWindowToVideo(percent, msg);
+                         });
+}
+
+void BakaEngine::FitWindowToVideo(int percent, bool msg)
+{
+    if(window->isFullScreen() || window->isMaximized()) // could have changed while we waited
+        return;
 
     const Mpv::VideoParams &vG = mpv->getFileInfo().video_params; // video geometry
     QRect mG = window->ui->mpvFrame->geometry(),                  // mpv geometry
@@ -679,18 +703,194 @@ void BakaEngine::BakaAbout(QStringList &args)
 }
 
 void BakaEngine::BakaMsgLevel(QStringList &args)
+{
+    // rules may be given comma or space separated: msg_level vd=debug all=warn
+    if(!args.empty())
+        mpv->MsgLevel(args.join(','));
+    else
+        RequiresParameters("msg_level");
+}
+
+void BakaEngine::BakaLogFile(QStringList &args)
+{
+    if(args.empty())
+        logFile->setEnabled(!logFile->getEnabled());
+    else
+    {
+        QString arg = args.join(' ');
+        if(arg == "on")
+            logFile->setEnabled(true);
+        else if(arg == "off")
+            logFile->setEnabled(false);
+        else
+        {
+            logFile->setFile(arg);
+            logFile->setEnabled(true);
+        }
+    }
+    if(logFile->getEnabled())
+        PrintLn(tr("logging to %0").arg(logFile->getFile() == QString() ? logFile->DefaultFile() : logFile->getFile()));
+    else
+        PrintLn(tr("log file disabled"));
+}
+
+void BakaEngine::BakaTrace(QStringList &args)
+{
+    if(!Tracing::Supported())
+    {
+        PrintLn(tr("tracing is not compiled in (qmake CONFIG+=tracing)"));
+        return;
+    }
+    if(args.empty())
+    {
+        RequiresParameters("trace");
+        return;
+    }
+    QString arg = args.front();
+    args.pop_front();
+    if(args.length() > 0) // remember the file for stop
+        traceFile = args.join(' ');
+    if(arg == "start")
+    {
+        Tracing::Start();
+        PrintLn(tr("tracing started"));
+    }
+    else if(arg == "stop")
+    {
+        Tracing::Stop();
+        if(traceFile == QString())
+        {
+            PrintLn(tr("tracing stopped; trace stop <file> saves it"));
+            return;
+        }
+        int n = Tracing::Save(traceFile);
+        if(n < 0)
+            PrintLn(tr("couldn't write %0").arg(traceFile));
+        else
+            PrintLn(tr("%0 events written to %1").arg(QString::number(n), traceFile));
+    }
+    else
+        InvalidParameter(arg);
+}
+
+void BakaEngine::BakaStalls(QStringList &args)
+{
+    if(!args.empty())
+    {
+        QString arg = args.join(' ');
+        bool ok;
+        int ms = arg.toInt(&ok);
+        if(arg == "reset")
+        {
+            watchdog->Reset();
+            PrintLn(tr("stall counts cleared"));
+        }
+        else if(ok && ms >= 0)
+        {
+            watchdog->setThreshold(ms);
+            if(ms == 0)
+                PrintLn(tr("stall watchdog disabled"));
+            else
+                PrintLn(tr("stalls over %0 ms are reported").arg(QString::number(ms)));
+        }
+        else
+            InvalidParameter(arg);
+        return;
+    }
+    if(watchdog->getThreshold() == 0)
+        PrintLn(tr("the stall watchdog is disabled; stalls <ms> enables it"));
+    QHash<QString, Watchdog::Stalls> stalls = watchdog->getStalls();
+    if(stalls.isEmpty())
+    {
+        PrintLn(tr("no stalls"));
+        return;
+    }
+    // the most time lost first
+    QStringList sites = stalls.keys();
+    std::sort(sites.begin(), sites.end(),
+              [&](const QString &a, const QString &b)
+              {
+                  return stalls[a].total > stalls[b].total;
+              });
+    PrintLn(tr("count   total ms     max ms  site"));
+    for(auto &site : sites)
+    {
+        const Watchdog::Stalls &s = stalls[site];
+        PrintLn(QString("%0 %1 %2  %3").arg(s.count, 5)
+                                       .arg(s.total, 10, 'f', 0)
+                                       .arg(s.max, 10, 'f', 0)
+                                       .arg(site));
+    }
+}
+
+void BakaEngine::BakaControl(QStringList &args)
 {
     if(!args.empty())
+    {
+        QString arg = args.join(' ');
+        if(arg == "off")
+            control->Close();
+        else if(!control->Listen(arg))
+        {
+            PrintLn(tr("couldn't listen on %0").arg(arg));
+            return;
+        }
+    }
+    if(control->getSocket() == QString())
+        PrintLn(tr("control socket closed"));
+    else
+        PrintLn(tr("control socket at %0").arg(control->getSocket()));
+}
+
+void BakaEngine::BakaSource(QStringList &args)
+{
+    if(!args.empty())
+        Source(args.join(' '));
+    else
+        RequiresParameters("source");
+}
+
+void BakaEngine::Source(QString file)
+{
+    Script *script = new Script(file, this);
+    connect(script, &Script::messageSignal,
+            [=](QString msg)
+            {
+                PrintLn(msg, "script");
+            });
+    if(script->Load())
+        script->Start();
+    else
+        delete script;
+}
+
+void BakaEngine::BakaOsdBackend(QStringList &args)
+{
+    if(args.empty())
+        overlay->setNativeOsd(!overlay->getNativeOsd());
+    else
     {
         QString arg = args.front();
         args.pop_front();
         if(args.empty())
-            mpv->MsgLevel(arg);
+        {
+            if(arg == "native")
+                overlay->setNativeOsd(true);
+            else if(arg == "qt")
+                overlay->setNativeOsd(false);
+            else
+            {
+                InvalidParameter(arg);
+                return;
+            }
+        }
         else
+        {
             InvalidParameter(args.join(' '));
+            return;
+        }
     }
-    else
-        RequiresParameters("msg_level");
+    PrintLn(tr("osd backend: %0").arg(overlay->getNativeOsd() ? "native" : "qt"));
 }
 
 void BakaEngine::About(QString what)
@@ -2,6 +2,11 @@
 
 #include <QMessageBox>
 #include <QDir>
+#include <QScrollBar>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QKeySequence>
+#include <QThread>
 
 #include "ui/mainwindow.h"
 #include "ui_mainwindow.h"
@@ -10,9 +15,27 @@
 #include "gesturehandler.h"
 #include "overlayhandler.h"
 #include "updatemanager.h"
+#include "thumbnailhandler.h"
+#include "waveformhandler.h"
+#include "watchhistory.h"
+#include "sessionjournal.h"
+#include "singleinstance.h"
+#include "controlserver.h"
+#include "headless.h"
+#include "replay.h"
+#include "recording.h"
+#include "watchdog.h"
+#include "tracing.h"
 #include "widgets/dimdialog.h"
+#include "logbuffer.h"
+#include "logfile.h"
+#include "benchmark.h"
 #include "util.h"
 
+#define LOG_BUFFER_SIZE 4096    // messages queued between flushes before we start dropping
+#define LOG_FLUSH_RATE 50       // ms between writes to the output
+#define LOG_MAX_LINES 5000      // lines kept by the output textbox
+
 BakaEngine::BakaEngine(QObject *parent):
     QObject(parent),
     window(static_cast<MainWindow*>(parent)),
@@ -20,99 +43,354 @@ BakaEngine::BakaEngine(QObject *parent):
     settings(new Settings(Util::SettingsLocation(), this)),
     gesture(new GestureHandler(this)),
     overlay(new OverlayHandler(this)),
-    update(new UpdateManager(this)),
-    // note: trayIcon does not work in my environment--known qt bug
-    // see: https://bugreports.qt-project.org/browse/QTBUG-34364
-    sysTrayIcon(new QSystemTrayIcon(window->windowIcon(), this)),
-    // todo: tray menu/tooltip
+    thumbnail(new ThumbnailHandler(this)),
+    waveform(new WaveformHandler(this)),
+    history(new WatchHistory(QStandardPaths::writableLocation(QStandardPaths::DataLocation)+"/history.log", this)),
+    session(new SessionJournal(QStandardPaths::writableLocation(QStandardPaths::DataLocation)+"/session.journal", this)),
+    instance(new SingleInstance(this)),
+    control(new ControlServer(this)),
+    watchdog(new Watchdog(this)),
+    headless(Headless::Requested() ? new Headless(this) : nullptr),
+    replay(Replay::Requested() != QString() ? new Replay(this) : nullptr),
+    dimDialog(nullptr),
+    sysTrayIcon(nullptr),
     translator(nullptr),
-    qtTranslator(nullptr)
+    qtTranslator(nullptr),
+    update(nullptr),
+    dimSupported(Util::DimLightsSupported()),
+    mpvReady(false),
+    logBuffer(new LogBuffer(LOG_BUFFER_SIZE)),
+    logTimer(new QTimer(this)),
+    logScheduled(false),
+    logFile(new LogFile(this)),
+    capture(nullptr)
 {
-    if(Util::DimLightsSupported())
-        dimDialog = new DimDialog(window, nullptr);
-    else
-    {
-        dimDialog = nullptr;
+    logFile->setRing(logBuffer);
+    logTimer->setSingleShot(true);
+    logTimer->setInterval(LOG_FLUSH_RATE);
+    connect(logTimer, &QTimer::timeout,
+            this, &BakaEngine::FlushLog);
+    window->ui->outputTextEdit->setMaximumBlockCount(LOG_MAX_LINES);
+    if(!dimSupported)
         window->ui->action_Dim_Lights->setEnabled(false);
-    }
+
+    // reading the settings and the history is all disk; do it while the window is being built.
+    //  neither is touched again until LoadSettings()
+    prefetch = std::async(std::launch::async,
+                          [=]
+                          {
+                              settings->Load();
+                              history->Open();
+                          });
 
     connect(mpv, &MpvHandler::messageSignal,
             [=](QString msg)
             {
                 Print(msg, "mpv");
             });
-    connect(update, &UpdateManager::messageSignal,
+    connect(mpv, &MpvHandler::logMessage,
+            [=](const Mpv::LogMessage &msg)
+            {
+                Print(msg.text, "mpv/"+msg.prefix);
+            });
+    connect(settings, &Settings::messageSignal,
+            [=](QString msg)
+            {
+                Print(msg, "settings");
+            });
+    connect(instance, &SingleInstance::messageSignal,
+            [=](QString msg)
+            {
+                PrintLn(msg, "instance");
+            });
+    connect(control, &ControlServer::messageSignal,
             [=](QString msg)
             {
-                Print(msg, "update");
+                PrintLn(msg, "control");
             });
+    // it reports from its own thread
+    connect(watchdog, &Watchdog::messageSignal, this,
+            [=](QString msg)
+            {
+                PrintLn(msg, "watchdog");
+            });
+
+    if(Recording::Requested() != QString() && !Recording::IsActive())
+        PrintLn(tr("couldn't record to %0").arg(Recording::Requested()), "record");
 }
 
 BakaEngine::~BakaEngine()
 {
+    if(prefetch.valid())
+        prefetch.wait();
     if(translator != nullptr)
         delete translator;
     if(qtTranslator != nullptr)
         delete qtTranslator;
     if(dimDialog != nullptr)
         delete dimDialog;
-    delete update;
+    if(headless != nullptr)
+        delete headless;
+    if(replay != nullptr)
+        delete replay;
+    delete watchdog;
+    delete control;
+    delete instance;
+    delete session;
+    delete history;
+    delete waveform;
+    delete thumbnail;
+    if(update != nullptr)
+        delete update;
     delete overlay;
     delete gesture;
     delete settings;
     delete mpv;
+    // anything still queued goes out before the log file closes
+    FlushLog();
+    delete logFile;
+    delete logBuffer;
 }
 
 void BakaEngine::LoadSettings()
 {
-    settings->Load();
+    QElapsedTimer timer;
+    timer.start();
+    prefetch.get();
+    Benchmark::Mark("settings.load");
+    qint64 waited = timer.nsecsElapsed();
+    timer.start();
     Load2_0_3();
+    Benchmark::Mark("settings.apply");
+    PrintLn(tr("loaded from %0 in %1ms (waited %2ms), applied in %3ms").arg(
+                settings->getLoadSource(),
+                QString::number(settings->getLoadTime()/1000.0, 'f', 2),
+                QString::number(waited/1000000.0, 'f', 2),
+                QString::number(timer.nsecsElapsed()/1000000.0, 'f', 2)),
+            "settings");
+}
+
+UpdateManager *BakaEngine::getUpdateManager()
+{
+    // the QNetworkAccessManager behind it is slow to bring up, and most sessions never check
+    if(update == nullptr)
+    {
+        update = new UpdateManager(this);
+        connect(update, &UpdateManager::messageSignal,
+                [=](QString msg)
+                {
+                    Print(msg, "update");
+                });
+    }
+    return update;
+}
+
+DimDialog *BakaEngine::getDimDialog()
+{
+    // the dialog is a full screen window of its own; only build it if we're asked to dim
+    if(dimDialog == nullptr && dimSupported)
+    {
+        dimDialog = new DimDialog(window, nullptr);
+        connect(dimDialog, &DimDialog::visbilityChanged,
+                [=](bool dim)
+                {
+                    window->ui->action_Dim_Lights->setChecked(dim);
+                    if(dim)
+                        Util::SetAlwaysOnTop(window->winId(), true);
+                    else if(window->getOnTop() == "never" || (window->getOnTop() == "playing" && mpv->getPlayState() > 0))
+                        Util::SetAlwaysOnTop(window->winId(), false);
+                });
+    }
+    return dimDialog;
+}
+
+void BakaEngine::TrayIcon(bool visible)
+{
+    if(sysTrayIcon == nullptr)
+    {
+        if(!visible)
+            return;
+        // note: trayIcon does not work in my environment--known qt bug
+        // see: https://bugreports.qt-project.org/browse/QTBUG-34364
+        sysTrayIcon = new QSystemTrayIcon(window->windowIcon(), this);
+        // todo: tray menu/tooltip
+        connect(sysTrayIcon, &QSystemTrayIcon::activated,
+                [=](QSystemTrayIcon::ActivationReason reason)
+                {
+                    if(reason == QSystemTrayIcon::Trigger)
+                    {
+                        if(!window->getHidePopup())
+                        {
+                            if(mpv->getPlayState() == Mpv::Playing)
+                                sysTrayIcon->showMessage("Baka MPlayer", tr("Playing"), QSystemTrayIcon::NoIcon, 4000);
+                            else if(mpv->getPlayState() == Mpv::Paused)
+                                sysTrayIcon->showMessage("Baka MPlayer", tr("Paused"), QSystemTrayIcon::NoIcon, 4000);
+                        }
+                        PlayPause();
+                    }
+                });
+    }
+    sysTrayIcon->setVisible(visible);
 }
 
 void BakaEngine::Command(QString command)
 {
     if(command == QString())
         return;
+    BAKA_TRACE("BakaEngine::Command");
+    CompiledCommand run = Compile(command);
+    if(run)
+        run();
+}
+
+// a replay runs unattended, against a fake mpv and the test mode data paths; it mustn't wait on
+//  a dialog nobody will answer or do anything for real outside the player
+static bool Replayable(QString command)
+{
+    QStringList args = command.split(' ', QString::SkipEmptyParts);
+    if(!args.empty() && args.front() == "baka")
+        args.pop_front();
+    QString name = args.value(0);
+    if(QStringList{"sh", "new", "show_in_folder", "online_help", "update", "preferences", "about",
+                   "jump", "open_location", "open_clipboard", "screenshot"}.contains(name))
+        return false;
+    // these only bring up a dialog without a file
+    if(args.length() == 1 && QStringList{"open", "add_subtitles", "add_audio"}.contains(name))
+        return false;
+    return true;
+}
+
+void BakaEngine::Dispatch(QString command, std::function<void()> run)
+{
+    BAKA_TRACE("BakaEngine::Dispatch");
+    if(replay != nullptr && !Replayable(command))
+    {
+        PrintLn(tr("not replayed: %0").arg(command), "replay");
+        return;
+    }
+    Recording::Command(command);
+    WhenReady(run);
+}
+
+BakaEngine::CompiledCommand BakaEngine::Compile(QString command, QString source)
+{
+    QString prefix = source == QString() ? QString() : source+": ";
     QStringList args = command.split(" ");
-    if(!args.empty())
+    if(!args.empty() && args.front() == "baka") // implicitly understood
+        args.pop_front();
+    if(args.empty())
+    {
+        PrintLn(prefix+tr("'%0' requires parameters").arg("baka"));
+        return CompiledCommand();
+    }
+    auto iter = BakaCommandMap.find(args.front());
+    if(iter == BakaCommandMap.end())
+    {
+        PrintLn(prefix+tr("invalid command '%0'").arg(args.join(' ')));
+        return CompiledCommand();
+    }
+    BakaCommandFPtr function = iter->first;
+    args.pop_front();
+    // commands may consume their arguments; each run gets its own (shared until touched) copy
+    return [=]
     {
-        if(args.front() == "baka") // implicitly understood
-            args.pop_front();
+        Dispatch(command, [=]
+                 {
+                     QStringList a = args;
+                     (this->*function)(a);
+                 });
+    };
+}
+
+void BakaEngine::WhenReady(std::function<void()> run)
+{
+    if(mpvReady)
+        run();
+    else
+        pending.append(run);
+}
 
-        if(!args.empty())
+void BakaEngine::setReady()
+{
+    mpvReady = true;
+    // in the order they came in
+    QList<std::function<void()>> runs;
+    runs.swap(pending);
+    for(auto &run : runs)
+        run();
+}
+
+QHash<int, BakaEngine::CompiledCommand> BakaEngine::CompileInput()
+{
+    QHash<int, CompiledCommand> compiled;
+    for(auto iter = input.begin(); iter != input.end(); ++iter)
+    {
+        if(iter->first == QString()) // unbound (overrides a default)
+            continue;
+        QKeySequence key(iter.key());
+        if(key.count() != 1)
         {
-            auto iter = BakaCommandMap.find(args.front());
-            if(iter != BakaCommandMap.end())
-            {
-                args.pop_front();
-                (this->*(iter->first))(args); // execute command
-            }
-            else
-                InvalidCommand(args.join(' '));
+            PrintLn(tr("'%0' is not a key").arg(iter.key()));
+            continue;
         }
-        else
-            RequiresParameters("baka");
+        CompiledCommand run = Compile(iter->first, iter.key());
+        if(run)
+            compiled[key[0]] = run;
     }
-    else
-        InvalidCommand(args.join(' '));
+    return compiled;
+}
+
+QString BakaEngine::Capture(QString command)
+{
+    QString out,
+            *outer = capture;
+    capture = &out;
+    Command(command);
+    capture = outer;
+    return out;
 }
 
 void BakaEngine::Print(QString what, QString who)
 {
-    QString out = QString("[%0]: %1").arg(who, what);
-    (qStdout() << out).flush();
-    window->ui->outputTextEdit->moveCursor(QTextCursor::End);
-    window->ui->outputTextEdit->insertPlainText(out);
+    if(capture != nullptr && QThread::currentThread() == thread())
+        *capture += what;
+    if(!logBuffer->push(QString("[%0]: %1").arg(who, what)))
+        return; // full; FlushLog reports the drop
+    // the first message after a flush schedules the next one (from whichever thread we're on)
+    if(!logScheduled.exchange(true))
+        QMetaObject::invokeMethod(logTimer, "start", Qt::QueuedConnection);
 }
 
-void BakaEngine::PrintLn(QString what, QString who)
+void BakaEngine::FlushLog()
 {
-    Print(what+"\n", who);
+    logScheduled = false; // anything pushed from here on schedules another flush
+
+    QString batch, out;
+    while(logBuffer->pop(out))
+        batch += out;
+    quint64 dropped = logBuffer->takeDropped();
+    if(dropped > 0)
+        batch += QString("[baka]: %0\n").arg(tr("%0 log messages dropped").arg(QString::number(dropped)));
+    if(batch == QString())
+        return;
+
+    (qStdout() << batch).flush();
+    logFile->write(batch);
+    // one insert per batch keeps the document layout off the hot path;
+    //  maximumBlockCount trims the oldest lines
+    QPlainTextEdit *output = window->ui->outputTextEdit;
+    QScrollBar *scroll = output->verticalScrollBar();
+    bool follow = scroll->value() == scroll->maximum();
+    QTextCursor cursor(output->document());
+    cursor.movePosition(QTextCursor::End);
+    cursor.insertText(batch);
+    if(follow)
+        scroll->setValue(scroll->maximum());
 }
 
-void BakaEngine::InvalidCommand(QString command)
+void BakaEngine::PrintLn(QString what, QString who)
 {
-    PrintLn(tr("invalid command '%0'").arg(command));
+    Print(what+"\n", who);
 }
 
 void BakaEngine::InvalidParameter(QString parameter)
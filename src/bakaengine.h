@@ -5,9 +5,15 @@
 #include <QString>
 #include <QStringList>
 #include <QHash>
+#include <QList>
 #include <QSystemTrayIcon>
 #include <QMenu>
 #include <QTranslator>
+#include <QTimer>
+
+#include <atomic>
+#include <future>
+#include <functional>
 
 class MainWindow;
 class MpvHandler;
@@ -15,7 +21,18 @@ class Settings;
 class GestureHandler;
 class OverlayHandler;
 class UpdateManager;
+class ThumbnailHandler;
+class WaveformHandler;
+class WatchHistory;
+class SessionJournal;
+class SingleInstance;
+class ControlServer;
+class Watchdog;
+class Headless;
+class Replay;
 class DimDialog;
+class LogBuffer;
+class LogFile;
 
 class BakaEngine : public QObject
 {
@@ -29,10 +46,18 @@ public:
     Settings       *settings;
     GestureHandler *gesture;
     OverlayHandler *overlay;
-    UpdateManager  *update;
-    DimDialog      *dimDialog;
+    ThumbnailHandler *thumbnail;
+    WaveformHandler *waveform;
+    WatchHistory   *history;
+    SessionJournal *session;
+    SingleInstance *instance;
+    ControlServer  *control;
+    Watchdog       *watchdog;
+    Headless       *headless;      // nullptr unless --headless
+    Replay         *replay;        // nullptr unless --replay
+    DimDialog      *dimDialog;      // nullptr until the lights are first dimmed
 
-    QSystemTrayIcon *sysTrayIcon;
+    QSystemTrayIcon *sysTrayIcon;   // nullptr until the icon is first shown
     QMenu           *trayIconMenu;
 
     QTranslator     *translator,
@@ -95,27 +120,73 @@ public:
         {"Del",             {"playlist remove",                     tr("Remove selected file from playlist")}}
     };
 
+    // a command parsed once, to be run any number of times (key bindings, menu actions).
+    //  if it doesn't parse this prints why (prefixed with source) and returns an empty function.
+    //  runs go through Dispatch()
+    typedef std::function<void()> CompiledCommand;
+    CompiledCommand Compile(QString command, QString source = QString());
+    QHash<int, CompiledCommand> CompileInput(); // input by modifiers|key; bad bindings are reported and left out
+
+    // created the first time they're needed; none of them are on the way to the first frame
+    UpdateManager *getUpdateManager();
+    DimDialog *getDimDialog();      // nullptr if dimming isn't supported here
+    bool getTrayIcon() { return sysTrayIcon != nullptr && sysTrayIcon->isVisible(); }
+
+    // mpv initializes on a worker while the window is already up and taking input; anything
+    //  that talks to it from the gui before then is held here and run in order once it's ready
+    void WhenReady(std::function<void()> run);
+    // every compiled command is run through here, whatever it came from (console, scripts, the
+    //  control socket, key bindings, menu actions): it's recorded, traced and held until mpv is ready.
+    //  the mouse driven controls come through here too, with the command that does the same thing.
+    //  a replay refuses the ones that would wait on a dialog or reach outside the player
+    void Dispatch(QString command, std::function<void()> run);
+    bool getMpvReady() { return mpvReady; }
+    void setReady(); // mpv is initialized and the file (if any) handed to it
+
 public slots:
     void LoadSettings();
     void SaveSettings();
 
     void Command(QString command);
+    // runs it and returns what it printed meanwhile (it still goes to the output too);
+    //  what comes once mpv answers isn't in it
+    QString Capture(QString command);
+
+    void TrayIcon(bool visible);
 
 protected slots:
     // Utility functions
     void Print(QString what, QString who = "baka");
     void PrintLn(QString what, QString who = "baka");
-    void InvalidCommand(QString);
     void InvalidParameter(QString);
     void RequiresParameters(QString);
 
     // Settings Loading
     void Load2_0_3();
 
+    void FlushLog();
+
 signals:
 
 
 private:
+    UpdateManager *update;
+    bool dimSupported;  // asked once up front so the menu item starts out right; the dialog waits
+    bool mpvReady;
+    QList<std::function<void()>> pending; // see WhenReady()
+
+    // settings->Load() and history->Open() run on a worker from the constructor;
+    //  LoadSettings() waits for them
+    std::future<void> prefetch;
+
+    // log messages are queued here and written to the output in batches by logTimer
+    LogBuffer *logBuffer;
+    QTimer *logTimer;
+    std::atomic<bool> logScheduled;
+    LogFile *logFile;
+    QString *capture; // what's printed on the gui thread goes here too, see Capture()
+    QString traceFile;
+
     // This is a baka-command hashtable initialized below
     //  by using a hash-table -> function pointer we acheive O(1) function lookups
     // Format: void BakaCommand(QStringList args)
@@ -222,6 +293,15 @@ private:
           }
          }
         },
+        {"rewind",
+         {&BakaEngine::BakaRewind,
+          {
+           QString(),
+           tr("restarts the file, or stops if it's near the start (the rewind button)"),
+           QString()
+          }
+         }
+        },
         {"playlist",
          {&BakaEngine::BakaPlaylist,
           {
@@ -414,8 +494,62 @@ private:
         {"msg_level",
          {&BakaEngine::BakaMsgLevel,
           {
-           tr("[level]"),
-           tr("set mpv msg-level"),
+           tr("[level|module=level,...]"),
+           tr("set mpv msg-level (eg. vd=debug,all=warn)"),
+           QString()
+          }
+         }
+        },
+        {"log_file",
+         {&BakaEngine::BakaLogFile,
+          {
+           tr("[on|off|file]"),
+           tr("toggles writing the output to a log file, or sets the file"),
+           QString()
+          }
+         }
+        },
+        {"trace",
+         {&BakaEngine::BakaTrace,
+          {
+           tr("start|stop [file]"),
+           tr("records a trace (needs CONFIG+=tracing) and saves it as chrome trace json"),
+           QString()
+          }
+         }
+        },
+        {"stalls",
+         {&BakaEngine::BakaStalls,
+          {
+           tr("[reset|threshold]"),
+           tr("shows where the gui stalled, clears the counts, or sets the threshold in ms (0 disables)"),
+           QString()
+          }
+         }
+        },
+        {"control",
+         {&BakaEngine::BakaControl,
+          {
+           tr("[socket|off]"),
+           tr("serves json-rpc on a local socket, or stops"),
+           QString()
+          }
+         }
+        },
+        {"source",
+         {&BakaEngine::BakaSource,
+          {
+           tr("[file]"),
+           tr("runs a script of commands"),
+           QString()
+          }
+         }
+        },
+        {"osd_backend",
+         {&BakaEngine::BakaOsdBackend,
+          {
+           tr("[native|qt]"),
+           tr("toggles or sets the text osd renderer"),
            QString()
           }
          }
@@ -442,6 +576,7 @@ private:
     void BakaScreenshot(QStringList&);
     void BakaMediaInfo(QStringList&);
     void BakaStop(QStringList&);
+    void BakaRewind(QStringList&);
     void BakaPlaylist(QStringList&);
     void BakaJump(QStringList&);
     void BakaDim(QStringList&);
@@ -465,6 +600,12 @@ private:
     void BakaHelp(QStringList&);
     void BakaAbout(QStringList&);
     void BakaMsgLevel(QStringList&);
+    void BakaLogFile(QStringList&);
+    void BakaTrace(QStringList&);
+    void BakaStalls(QStringList&);
+    void BakaControl(QStringList&);
+    void BakaSource(QStringList&);
+    void BakaOsdBackend(QStringList&);
     void BakaQuit(QStringList&);
 public:
     void Open();
@@ -474,7 +615,9 @@ public:
     void PlayPause();
     void Jump();
     void FitWindow(int percent = 0, bool msg = true);
+    void FitWindowToVideo(int percent, bool msg); // FitWindow() once the video params are in
     void Dim(bool dim);
+    void Source(QString file);
     void About(QString what = QString());
     void Quit();
 };
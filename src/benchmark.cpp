@@ -0,0 +1,146 @@
+#include "benchmark.h"
+
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QProcess>
+#include <QList>
+#include <QPair>
+#include <QMap>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+
+#include <algorithm> // for std::sort
+
+#include "util.h"
+
+#define BENCHMARK_TIMEOUT 30000 // ms a run gets to reach its first frame
+
+namespace Benchmark {
+
+static QElapsedTimer timer;
+static bool active = false,
+            finished = false;
+static QList<QPair<QString, double>> phases;
+
+void Start()
+{
+    timer.start();
+}
+
+bool IsActive()
+{
+    return active;
+}
+
+void SetActive(bool b)
+{
+    active = b;
+}
+
+void Mark(QString phase)
+{
+    if(active)
+        phases.append({phase, timer.nsecsElapsed()/1000000.0});
+}
+
+void Finish()
+{
+    if(!active || finished)
+        return;
+    finished = true;
+    QJsonArray phases_json;
+    for(auto &phase : phases)
+    {
+        QJsonObject phase_json;
+        phase_json["phase"] = phase.first;
+        phase_json["ms"] = phase.second;
+        phases_json.append(phase_json);
+    }
+    QJsonObject root;
+    root["phases"] = phases_json;
+    (qStdout() << QJsonDocument(root).toJson(QJsonDocument::Compact) << "\n").flush();
+    QCoreApplication::quit();
+}
+
+static QJsonObject Stats(QList<double> values)
+{
+    std::sort(values.begin(), values.end());
+    QJsonObject stats;
+    stats["min"] = values.first();
+    stats["median"] = values[values.length()/2];
+    stats["max"] = values.last();
+    return stats;
+}
+
+int Run(QStringList args, int iterations)
+{
+    QString program = args.takeFirst();
+    args.append("--benchmark-startup-run");
+
+    // the first start pays for whatever isn't cached yet; the rest are warm.
+    //  (for a truly cold first start, drop the os file cache beforehand)
+    QMap<QString, QList<double>> warm;
+    QJsonObject first;
+    int failed = 0;
+    for(int i = 1; i <= iterations; ++i)
+    {
+        QProcess process;
+        process.setProcessChannelMode(QProcess::SeparateChannels);
+        process.start(program, args);
+        bool timedout = false;
+        if(!process.waitForFinished(BENCHMARK_TIMEOUT))
+        {
+            // kill() replaces the timeout with a crash as far as error() goes
+            timedout = process.error() == QProcess::Timedout;
+            process.kill();
+            process.waitForFinished();
+        }
+
+        // the run prints its own output too; ours is the json line with the phases
+        QJsonArray phases_json;
+        for(auto &line : process.readAllStandardOutput().split('\n'))
+        {
+            QJsonObject line_json = QJsonDocument::fromJson(line).object();
+            if(line_json.contains("phases"))
+                phases_json = line_json["phases"].toArray();
+        }
+
+        QJsonObject result;
+        result["iteration"] = i;
+        result["cache"] = i == 1 ? "first" : "warm";
+        if(phases_json.isEmpty())
+        {
+            result["error"] = timedout ? "timeout" : "no result";
+            ++failed;
+        }
+        else
+        {
+            result["phases"] = phases_json;
+            for(auto phase : phases_json)
+            {
+                QJsonObject phase_json = phase.toObject();
+                if(i == 1)
+                    first[phase_json["phase"].toString()] = phase_json["ms"];
+                else
+                    warm[phase_json["phase"].toString()].append(phase_json["ms"].toDouble());
+            }
+        }
+        (qStdout() << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n").flush();
+    }
+
+    QJsonObject warm_json;
+    for(auto phase = warm.begin(); phase != warm.end(); ++phase)
+        warm_json[phase.key()] = Stats(*phase);
+    QJsonObject summary;
+    summary["iterations"] = iterations;
+    summary["failed"] = failed;
+    summary["first"] = first;
+    summary["warm"] = warm_json;
+    QJsonObject root;
+    root["summary"] = summary;
+    (qStdout() << QJsonDocument(root).toJson(QJsonDocument::Compact) << "\n").flush();
+    return failed > 0 ? 1 : 0;
+}
+
+}
@@ -0,0 +1,23 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <QString>
+#include <QStringList>
+
+// --benchmark-startup[=N]: starts the player N times and reports how long each startup phase
+//  took (ms since main), up to the first frame, as json lines on stdout.
+// each run is a separate process (--benchmark-startup-run) that exits once it's done;
+//  it runs in QStandardPaths' test mode so it has settings, history and caches of its own.
+namespace Benchmark {
+
+void Start();               // call first thing in main
+bool IsActive();            // this process is a benchmark run
+void SetActive(bool b);
+void Mark(QString phase);   // no-op unless active
+void Finish();              // prints the phases and quits; only the first call counts
+
+int Run(QStringList args, int iterations); // the parent; returns the exit code
+
+}
+
+#endif // BENCHMARK_H
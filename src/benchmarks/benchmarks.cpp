@@ -0,0 +1,299 @@
+#include <QtTest>
+#include <QApplication>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "headless.h"
+#include "mpvhandler.h"
+#include "overlayhandler.h"
+#include "settings.h"
+#include "util.h"
+#include "ui/mainwindow.h"
+#include "ui_mainwindow.h"
+#include "widgets/playlistwidget.h"
+
+#include <locale.h>
+
+#define PLAYLIST_FILES 100000   // files in the directory playlists are built from
+#define SETTINGS_GROUPS 200     // the large settings files have SETTINGS_GROUPS*SETTINGS_KEYS keys
+#define SETTINGS_KEYS 100
+
+// gets at the parts of Settings::Load() that aren't public
+class BenchSettings : public Settings
+{
+public:
+    using Settings::Settings;
+    using Settings::LoadIni;
+    using Settings::SnapshotFile;
+};
+
+// run with -o <file>,csv (or xml) to get results that can be compared between commits;
+//  see README.md
+class Benchmarks : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+
+    void formatTime_data();
+    void formatTime();
+    void isValidUrl_data();
+    void isValidUrl();
+    void isValidLocation_data();
+    void isValidLocation();
+    void shortenPathToParent_data();
+    void shortenPathToParent();
+    void settingsLoadIni();
+    void settingsLoad_data();
+    void settingsLoad();
+    void populatePlaylist();
+    void playlistSearch_data();
+    void playlistSearch();
+    void showText_data();
+    void showText();
+
+private:
+    QTemporaryDir dir;
+    QString media;      // PLAYLIST_FILES files, a quarter of them not media
+    QByteArray ini;
+    MainWindow *window;
+};
+
+void Benchmarks::initTestCase()
+{
+    QVERIFY(dir.isValid());
+
+    // the tree playlists are built from
+    media = dir.path()+"/media/";
+    QVERIFY(QDir().mkpath(media));
+    static const char *suffixes[] = {"mkv", "mp4", "mp3", "txt"};
+    for(int i = 0; i < PLAYLIST_FILES; ++i)
+    {
+        QFile f(QString("%0file-%1.%2").arg(media, QString::number(i), suffixes[i%4]));
+        QVERIFY(f.open(QIODevice::WriteOnly));
+    }
+
+    // the same large settings in both formats
+    QJsonObject root;
+    for(int g = 0; g < SETTINGS_GROUPS; ++g)
+    {
+        QByteArray group = "group"+QByteArray::number(g);
+        QJsonObject group_obj;
+        ini += "["+group+"]\n";
+        for(int k = 0; k < SETTINGS_KEYS; ++k)
+        {
+            QByteArray key = "key"+QByteArray::number(k);
+            switch(k%3)
+            {
+            case 0:
+                ini += key+"=true\n";
+                group_obj[key] = true;
+                break;
+            case 1:
+                ini += key+"="+QByteArray::number(g*k)+"\n";
+                group_obj[key] = g*k;
+                break;
+            default:
+                ini += key+"=some text for "+key+"\n";
+                group_obj[key] = QString("some text for "+key);
+            }
+        }
+        root[group] = group_obj;
+    }
+    QFile fini(dir.path()+"/settings.ini"),
+          fjson(dir.path()+"/settings.json");
+    QVERIFY(fini.open(QIODevice::WriteOnly) && fini.write(ini) == ini.size());
+    QVERIFY(fjson.open(QIODevice::WriteOnly) && fjson.write(QJsonDocument(root).toJson()) > 0);
+
+    // the overlays and the playlist need the engine behind the window, not the window on screen;
+    //  it's never shown, so nothing here waits on a display or a window manager
+    window = new MainWindow();
+    window->resize(1280, 720);
+    window->layout()->activate(); // the frame the overlays are placed in gets its size without a show
+    QVERIFY(window->findChild<MpvHandler*>()->LoadPlaylist(media) != QString());
+}
+
+void Benchmarks::cleanupTestCase()
+{
+    delete window;
+}
+
+void Benchmarks::formatTime_data()
+{
+    QTest::addColumn<int>("time");
+    QTest::addColumn<int>("total");
+    QTest::newRow("seconds") << 42 << 59;
+    QTest::newRow("minutes") << 754 << 3599;
+    QTest::newRow("hours") << 4000 << 7200;
+}
+
+void Benchmarks::formatTime()
+{
+    QFETCH(int, time);
+    QFETCH(int, total);
+    QBENCHMARK
+    {
+        Util::FormatTime(time, total);
+    }
+}
+
+void Benchmarks::isValidUrl_data()
+{
+    QTest::addColumn<QString>("location");
+    QTest::newRow("url") << "https://www.youtube.com/watch?v=dQw4w9WgXcQ";
+    QTest::newRow("absolute") << "/home/user/Videos/Some Show/Some Show - 01 [1080p].mkv";
+    QTest::newRow("relative") << "../Some Show - 02 [1080p].mkv";
+    QTest::newRow("garbage") << "not a location at all";
+}
+
+void Benchmarks::isValidUrl()
+{
+    QFETCH(QString, location);
+    QBENCHMARK
+    {
+        Util::IsValidUrl(location);
+    }
+}
+
+void Benchmarks::isValidLocation_data()
+{
+    isValidUrl_data();
+}
+
+void Benchmarks::isValidLocation()
+{
+    QFETCH(QString, location);
+    QBENCHMARK
+    {
+        Util::IsValidLocation(location);
+    }
+}
+
+void Benchmarks::shortenPathToParent_data()
+{
+    QTest::addColumn<QString>("path");
+    QTest::addColumn<QString>("title");
+    QTest::newRow("titled") << "https://www.youtube.com/watch?v=dQw4w9WgXcQ" << "Some Video";
+    QTest::newRow("short") << "/home/user/Videos/Some Show/Some Show - 01.mkv" << QString();
+    QTest::newRow("long") << "/home/user/Videos/"+QString(150, 'd')+"/"+QString(150, 'f')+".mkv" << QString();
+}
+
+void Benchmarks::shortenPathToParent()
+{
+    QFETCH(QString, path);
+    QFETCH(QString, title);
+    Recent recent(path, title);
+    QBENCHMARK
+    {
+        Util::ShortenPathToParent(recent);
+    }
+}
+
+void Benchmarks::settingsLoadIni()
+{
+    // just the parse, from memory
+    BenchSettings settings(QString());
+    QBENCHMARK
+    {
+        settings.LoadIni(ini);
+    }
+}
+
+void Benchmarks::settingsLoad_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<QString>("source");
+    QTest::newRow("ini") << "settings.ini" << "ini";
+    QTest::newRow("json") << "settings.json" << "json";
+    QTest::newRow("snapshot") << "settings.json" << "snapshot";
+}
+
+void Benchmarks::settingsLoad()
+{
+    QFETCH(QString, file);
+    QFETCH(QString, source);
+    BenchSettings settings(dir.path()+"/"+file);
+    bool snapshot = source == "snapshot";
+    QFile::remove(settings.SnapshotFile());
+    if(snapshot)
+        settings.Load(); // leaves the snapshot behind
+    QBENCHMARK
+    {
+        // the other rows are for the parse; a snapshot from the last iteration would skip it
+        if(!snapshot)
+            QFile::remove(settings.SnapshotFile());
+        settings.Load();
+    }
+    QCOMPARE(settings.getLoadSource(), source);
+}
+
+void Benchmarks::populatePlaylist()
+{
+    // a handler of its own, so nothing's listening to what it finds
+    MpvHandler mpv(0);
+    QString first;
+    QBENCHMARK
+    {
+        first = mpv.LoadPlaylist(media);
+    }
+    QVERIFY(first != QString());
+}
+
+void Benchmarks::playlistSearch_data()
+{
+    QTest::addColumn<QString>("search");
+    QTest::newRow("everything") << QString();
+    QTest::newRow("many") << "file-1";
+    QTest::newRow("one") << "file-99999.";
+    QTest::newRow("none") << "nothing";
+}
+
+void Benchmarks::playlistSearch()
+{
+    QFETCH(QString, search);
+    PlaylistWidget *playlist = window->ui->playlistWidget;
+    QBENCHMARK
+    {
+        playlist->Search(search);
+    }
+}
+
+void Benchmarks::showText_data()
+{
+    QTest::addColumn<QString>("text");
+    QTest::newRow("status") << "Volume: 50%";
+    QStringList info;
+    for(int i = 0; i < 20; ++i)
+        info.append(QString("Line %0: some media info about the file").arg(i));
+    QTest::newRow("info") << info.join('\n');
+}
+
+void Benchmarks::showText()
+{
+    QFETCH(QString, text);
+    OverlayHandler *overlay = window->findChild<OverlayHandler*>();
+    QFont font(Util::MonospaceFont(), 14);
+    QBENCHMARK
+    {
+        // the same id each time, so each one replaces the last
+        overlay->showText(text, font, QColor(0xFFFFFF), QPoint(20, 20), 0, 1);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    // no display needed unless one's asked for; whatever the run writes goes to the test locations,
+    //  not the user's settings, history and session
+    if(qEnvironmentVariableIsEmpty("QT_QPA_PLATFORM"))
+        Headless::Prepare();
+    QStandardPaths::setTestModeEnabled(true);
+    QApplication a(argc, argv);
+    setlocale(LC_NUMERIC, "C"); // for mpv
+    Benchmarks benchmarks;
+    return QTest::qExec(&benchmarks, argc, argv);
+}
+
+#include "benchmarks.moc"
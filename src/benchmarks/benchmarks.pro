@@ -0,0 +1,30 @@
+#-------------------------------------------------
+#
+# QBENCHMARK cases for the player's hot paths; built against the same sources
+#  (baka.pri) but kept out of the player and its installs.
+#
+#  qmake && make && ./build/benchmarks -o results.csv,csv
+#
+#-------------------------------------------------
+
+QT       += testlib
+CODECFORSRC = UTF-8
+TARGET = benchmarks
+TEMPLATE = app
+
+CONFIG += console
+CONFIG -= app_bundle
+
+DESTDIR = build
+OBJECTS_DIR = $${DESTDIR}/obj
+MOC_DIR = $${DESTDIR}/moc
+RCC_DIR = $${DESTDIR}/rcc
+UI_DIR = $${DESTDIR}/ui
+
+include(../baka.pri)
+
+DEFINES += "BAKA_MPLAYER_VERSION=\\\"benchmark\\\"" \
+           "SETTINGS_FILE=\\\"bakamplayer\\\"" \
+           "BAKA_MPLAYER_LANG_PATH=\\\"\\\""
+
+SOURCES += benchmarks.cpp
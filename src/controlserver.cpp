@@ -0,0 +1,414 @@
+#include "controlserver.h"
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QJsonDocument>
+#include <QJsonParseError>
+#include <QTimer>
+
+#include <memory>
+
+#include "bakaengine.h"
+#include "mpvhandler.h"
+
+#define CONTROL_MAX_LINE 1024*1024          // bytes a request can take before we give up on the client
+#define CONTROL_HIGH_WATER 256*1024         // bytes queued for a client before its notifications are coalesced
+#define CONTROL_MAX_QUEUE 16*1024*1024      // bytes queued for a client before it's dropped
+
+// json-rpc error codes
+#define ERROR_PARSE -32700
+#define ERROR_INVALID_REQUEST -32600
+#define ERROR_METHOD_NOT_FOUND -32601
+#define ERROR_INVALID_PARAMS -32602
+#define ERROR_MPV -32000                    // message is mpv's error string
+
+static QJsonObject Error(int code, QString message)
+{
+    QJsonObject error;
+    error["code"] = code;
+    error["message"] = message;
+    return error;
+}
+
+static QJsonObject Response(const QJsonValue &id, const QJsonValue &result, const QJsonObject &error)
+{
+    QJsonObject response;
+    response["jsonrpc"] = QString("2.0");
+    if(error.isEmpty())
+        response["result"] = result;
+    else
+        response["error"] = error;
+    response["id"] = id;
+    return response;
+}
+
+ControlServer::ControlServer(QObject *parent):
+    QObject(parent),
+    baka(static_cast<BakaEngine*>(parent)),
+    server(nullptr)
+{
+    connect(baka->mpv, &MpvHandler::observedPropertyChanged,
+            this, &ControlServer::PropertyChanged);
+}
+
+ControlServer::~ControlServer()
+{
+    Close();
+}
+
+void ControlServer::Start()
+{
+    for(auto &arg : QCoreApplication::arguments())
+    {
+        if(arg.startsWith("--control-socket="))
+        {
+            QString s = arg.section('=', 1);
+            if(Listen(s))
+                emit messageSignal(tr("listening on %0").arg(s));
+            else
+                emit messageSignal(tr("couldn't listen on %0").arg(s));
+        }
+    }
+}
+
+bool ControlServer::Listen(QString s)
+{
+    Close();
+    server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(server, &QLocalServer::newConnection,
+            this, &ControlServer::Accept);
+    bool ok = server->listen(s);
+    if(!ok && server->serverError() == QAbstractSocket::AddressInUseError)
+    {
+        // only take the name over if whoever had it is gone
+        QLocalSocket probe;
+        probe.connectToServer(s);
+        if(!probe.waitForConnected(100))
+        {
+            QLocalServer::removeServer(s);
+            ok = server->listen(s);
+        }
+    }
+    if(!ok)
+    {
+        delete server;
+        server = nullptr;
+        return false;
+    }
+    socket = s;
+    return true;
+}
+
+void ControlServer::Close()
+{
+    // this can come from a client's own request ("baka control off"); nothing it's still
+    //  using goes away before we're back in the event loop
+    for(Client *client : clients.values())
+        Drop(client);
+    if(server != nullptr)
+    {
+        server->close();
+        server->deleteLater();
+        server = nullptr;
+    }
+    socket = QString();
+}
+
+void ControlServer::Accept()
+{
+    while(QLocalSocket *s = server->nextPendingConnection())
+    {
+        Client *client = new Client{s, QByteArray(), QSet<QString>(), QHash<QString, QJsonValue>(), false};
+        clients[s] = client;
+        connect(s, &QLocalSocket::readyRead,
+                [=]
+                {
+                    Read(client);
+                });
+        connect(s, &QLocalSocket::bytesWritten,
+                [=]
+                {
+                    Drain(client);
+                });
+        connect(s, &QLocalSocket::disconnected,
+                [=]
+                {
+                    Drop(client);
+                });
+        Read(client);
+    }
+}
+
+void ControlServer::Read(Client *client)
+{
+    client->in += client->socket->readAll();
+    int end;
+    while(!client->dropped && (end = client->in.indexOf('\n')) >= 0)
+    {
+        QByteArray line = client->in.left(end);
+        client->in.remove(0, end+1);
+        if(line.trimmed().isEmpty())
+            continue;
+
+        QJsonParseError parse;
+        QJsonDocument document = QJsonDocument::fromJson(line, &parse);
+        if(parse.error != QJsonParseError::NoError)
+            Send(client, Response(QJsonValue(), QJsonValue(), Error(ERROR_PARSE, parse.errorString())));
+        else if(document.isArray())
+        {
+            // a batch: everything in it is answered together, in one write, once the last answer is in
+            QJsonArray requests = document.array();
+            if(requests.isEmpty())
+            {
+                Send(client, Response(QJsonValue(), QJsonValue(), Error(ERROR_INVALID_REQUEST, tr("empty batch"))));
+                continue;
+            }
+            QPointer<QLocalSocket> socket = client->socket;
+            auto responses = std::make_shared<QJsonArray>();
+            auto left = std::make_shared<int>(requests.size());
+            for(auto request : requests)
+                Handle(client, request,
+                       [=](const QJsonValue &response)
+                       {
+                           if(!response.isNull())
+                               responses->append(response);
+                           if(--*left == 0 && !responses->isEmpty())
+                               Reply(socket, *responses);
+                       });
+        }
+        else
+        {
+            QPointer<QLocalSocket> socket = client->socket;
+            Handle(client, document.object(),
+                   [=](const QJsonValue &response)
+                   {
+                       if(!response.isNull())
+                           Reply(socket, response);
+                   });
+        }
+    }
+    if(client->in.size() > CONTROL_MAX_LINE)
+        client->dropped = true;
+    if(client->dropped)
+        Drop(client);
+}
+
+void ControlServer::Drain(Client *client)
+{
+    if(client->pending.isEmpty() || client->socket->bytesToWrite() > CONTROL_HIGH_WATER)
+        return;
+    // caught up; send what it missed, latest values only
+    QHash<QString, QJsonValue> pending;
+    pending.swap(client->pending);
+    for(auto iter = pending.begin(); iter != pending.end(); ++iter)
+        Notify(client, iter.key(), iter.value());
+    if(client->dropped)
+        Drop(client);
+}
+
+void ControlServer::Drop(Client *client)
+{
+    if(!clients.contains(client->socket))
+        return;
+    clients.remove(client->socket);
+    for(auto &name : client->subscriptions)
+        if(--subscribers[name] == 0)
+        {
+            subscribers.remove(name);
+            baka->mpv->Unobserve(name);
+        }
+    // Drop can be reached from under the client's own handlers (Read, Drain); it's marked dropped
+    //  so they stop, and goes with its socket once we're back in the event loop
+    client->dropped = true;
+    client->socket->disconnect();
+    client->socket->abort();
+    connect(client->socket, &QObject::destroyed,
+            [=]
+            {
+                delete client;
+            });
+    client->socket->deleteLater();
+}
+
+void ControlServer::DropLater(Client *client)
+{
+    QPointer<QLocalSocket> socket = client->socket;
+    QTimer::singleShot(0, this,
+                       [=]
+                       {
+                           if(Client *c = Find(socket))
+                               Drop(c);
+                       });
+}
+
+ControlServer::Client *ControlServer::Find(const QPointer<QLocalSocket> &socket)
+{
+    if(socket.isNull())
+        return nullptr;
+    return clients.value(socket.data(), nullptr);
+}
+
+void ControlServer::Send(Client *client, const QJsonValue &message)
+{
+    if(client->dropped)
+        return;
+    QByteArray data = message.isArray() ?
+                QJsonDocument(message.toArray()).toJson(QJsonDocument::Compact) :
+                QJsonDocument(message.toObject()).toJson(QJsonDocument::Compact);
+    // writes only ever queue; a client that doesn't read just grows its own queue, up to a point
+    if(client->socket->bytesToWrite()+data.size() > CONTROL_MAX_QUEUE)
+    {
+        client->dropped = true; // callers drop it once they're done with it
+        return;
+    }
+    client->socket->write(data+"\n");
+}
+
+void ControlServer::Reply(const QPointer<QLocalSocket> &socket, const QJsonValue &message)
+{
+    Client *client = Find(socket);
+    if(client == nullptr) // gone while mpv was at it
+        return;
+    Send(client, message);
+    if(client->dropped)
+        DropLater(client);
+}
+
+void ControlServer::Notify(Client *client, QString name, const QJsonValue &value)
+{
+    // while it's behind, newer values replace older ones instead of queueing up behind them
+    if(!client->pending.isEmpty() || client->socket->bytesToWrite() > CONTROL_HIGH_WATER)
+    {
+        client->pending[name] = value;
+        return;
+    }
+    QJsonObject params;
+    params["name"] = name;
+    params["value"] = value;
+    QJsonObject notification;
+    notification["jsonrpc"] = QString("2.0");
+    notification["method"] = QString("property");
+    notification["params"] = params;
+    Send(client, notification);
+}
+
+void ControlServer::PropertyChanged(QString name, const QVariant &value)
+{
+    QJsonValue json = QJsonValue::fromVariant(value);
+    for(Client *client : clients.values())
+    {
+        if(client->subscriptions.contains(name))
+        {
+            Notify(client, name, json);
+            if(client->dropped)
+                Drop(client);
+        }
+    }
+}
+
+void ControlServer::Handle(Client *client, const QJsonValue &request, Respond then)
+{
+    const QJsonObject object = request.toObject();
+    const QJsonValue id = object["id"];
+    if(!request.isObject() || !object["method"].isString() ||
+       !(object["params"].isArray() || object["params"].isUndefined()))
+    {
+        then(Response(id.isUndefined() ? QJsonValue() : id, QJsonValue(), Error(ERROR_INVALID_REQUEST, tr("invalid request"))));
+        return;
+    }
+
+    Call(client, object["method"].toString(), object["params"].toArray(),
+         [=](const QJsonValue &result, const QJsonObject &error)
+         {
+             if(id.isUndefined()) // notification; no answer wanted
+                 then(QJsonValue());
+             else
+                 then(Response(id, result, error));
+         });
+}
+
+void ControlServer::Call(Client *client, QString method, const QJsonArray &params, Result then)
+{
+    QStringList args;
+    for(auto param : params)
+    {
+        if(!param.isString())
+        {
+            then(QJsonValue(), Error(ERROR_INVALID_PARAMS, tr("params must be strings")));
+            return;
+        }
+        args.append(param.toString());
+    }
+
+    if(method == "baka")
+    {
+        then(baka->Capture(args.join(' ')), QJsonObject());
+        return;
+    }
+    else if(method == "mpv" || method == "get_property")
+    {
+        if(args.empty() || (method == "get_property" && args.length() != 1))
+        {
+            then(QJsonValue(), Error(ERROR_INVALID_PARAMS, tr("'%0' requires parameters").arg(method)));
+            return;
+        }
+        auto answer = [=](int code, const QVariant &value)
+        {
+            if(code < 0)
+                then(QJsonValue(), Error(ERROR_MPV, QString::fromUtf8(mpv_error_string(code))));
+            else
+                then(QJsonValue::fromVariant(value), QJsonObject());
+        };
+        if(method == "mpv")
+            baka->mpv->CommandAsync(args, answer);
+        else
+            baka->mpv->GetPropertyAsync(args.front(), answer);
+        return;
+    }
+    else if(method == "subscribe")
+    {
+        QPointer<QLocalSocket> socket = client->socket;
+        for(auto &name : args)
+        {
+            if(client->subscriptions.contains(name))
+                continue;
+            client->subscriptions.insert(name);
+            if(subscribers[name]++ == 0)
+                baka->mpv->Observe(name); // mpv sends the current value on its own
+            else
+            {
+                baka->mpv->GetPropertyAsync(name,
+                                            [=](int error, const QVariant &value)
+                                            {
+                                                Client *c = Find(socket);
+                                                if(error < 0 || c == nullptr || !c->subscriptions.contains(name))
+                                                    return;
+                                                Notify(c, name, QJsonValue::fromVariant(value));
+                                                if(c->dropped)
+                                                    DropLater(c);
+                                            });
+            }
+        }
+        then(QJsonValue(), QJsonObject());
+        return;
+    }
+    else if(method == "unsubscribe")
+    {
+        for(auto &name : args)
+        {
+            if(!client->subscriptions.remove(name))
+                continue;
+            client->pending.remove(name);
+            if(--subscribers[name] == 0)
+            {
+                subscribers.remove(name);
+                baka->mpv->Unobserve(name);
+            }
+        }
+        then(QJsonValue(), QJsonObject());
+        return;
+    }
+    then(QJsonValue(), Error(ERROR_METHOD_NOT_FOUND, tr("unknown method '%0'").arg(method)));
+}
@@ -0,0 +1,79 @@
+#ifndef CONTROLSERVER_H
+#define CONTROLSERVER_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QSet>
+#include <QJsonValue>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QPointer>
+
+#include <functional>
+
+class BakaEngine;
+class QLocalServer;
+class QLocalSocket;
+
+// json-rpc 2.0 over a local socket, one message per line (a batch is an array).
+//  methods: baka [command] (returns what it printed), mpv [args...], get_property [name], subscribe [names...], unsubscribe [names...]
+//  subscribed properties arrive as "property" notifications: {"name": ..., "value": ...}
+// mpv is asked without waiting on it; answers go out as they come in, a batch's once its last is in.
+// every client has its own output queue; one that stops reading gets its notifications
+//  coalesced to the latest value per property, and is dropped if it falls too far behind.
+class ControlServer : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ControlServer(QObject *parent = 0);
+    ~ControlServer();
+
+    QString getSocket() { return socket; } // empty if we're not listening
+
+public slots:
+    void Start(); // listens on --control-socket=<socket>, if given
+    bool Listen(QString s);
+    void Close();
+
+signals:
+    void messageSignal(QString msg);
+
+private slots:
+    void Accept();
+    void PropertyChanged(QString name, const QVariant &value);
+
+private:
+    struct Client
+    {
+        QLocalSocket *socket;
+        QByteArray in;
+        QSet<QString> subscriptions;
+        QHash<QString, QJsonValue> pending; // latest values held back while the client is behind
+        bool dropped;                       // too far behind, or let go; deleted along with its socket
+    };
+
+    typedef std::function<void(const QJsonValue &response)> Respond; // null for notifications
+    typedef std::function<void(const QJsonValue &result, const QJsonObject &error)> Result;
+
+    void Read(Client *client);
+    void Drain(Client *client);
+    void Drop(Client *client);      // the client and its socket are deleted later, never from here
+    void DropLater(Client *client); // from under whoever's handling it
+    void Send(Client *client, const QJsonValue &message);
+    void Reply(const QPointer<QLocalSocket> &socket, const QJsonValue &message);
+    void Notify(Client *client, QString name, const QJsonValue &value);
+    Client *Find(const QPointer<QLocalSocket> &socket); // nullptr once it's gone; answers can outlive clients
+
+    void Handle(Client *client, const QJsonValue &request, Respond then);
+    void Call(Client *client, QString method, const QJsonArray &params, Result then);
+
+    BakaEngine *baka;
+    QLocalServer *server;
+    QString socket;
+    QHash<QLocalSocket*, Client*> clients;
+    QHash<QString, int> subscribers; // property -> clients subscribed to it
+};
+
+#endif // CONTROLSERVER_H
@@ -0,0 +1,888 @@
+#include "fakempv.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <QFileInfo>
+#include <QDataStream>
+#include <QTextStream>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonParseError>
+#include <QSet>
+
+#include "recording.h"
+#include "replay.h"
+
+#define FAKE_MIN_WAIT 1 // ms; anything due sooner goes out now, with whatever else is due
+
+static const QHash<QString, mpv_event_id> fake_events = {
+    {"property",            MPV_EVENT_PROPERTY_CHANGE},
+    {"log",                 MPV_EVENT_LOG_MESSAGE},
+    {"start-file",          MPV_EVENT_START_FILE},
+    {"file-loaded",         MPV_EVENT_FILE_LOADED},
+    {"playback-restart",    MPV_EVENT_PLAYBACK_RESTART},
+    {"pause",               MPV_EVENT_PAUSE},
+    {"unpause",             MPV_EVENT_UNPAUSE},
+    {"end-file",            MPV_EVENT_END_FILE},
+    {"idle",                MPV_EVENT_IDLE},
+    {"shutdown",            MPV_EVENT_SHUTDOWN}
+};
+
+static const QList<QPair<QString, int>> fake_levels = {
+    {"no",      MPV_LOG_LEVEL_NONE},
+    {"fatal",   MPV_LOG_LEVEL_FATAL},
+    {"error",   MPV_LOG_LEVEL_ERROR},
+    {"warn",    MPV_LOG_LEVEL_WARN},
+    {"info",    MPV_LOG_LEVEL_INFO},
+    {"status",  MPV_LOG_LEVEL_INFO},
+    {"v",       MPV_LOG_LEVEL_V},
+    {"debug",   MPV_LOG_LEVEL_DEBUG},
+    {"trace",   MPV_LOG_LEVEL_TRACE}
+};
+
+// json has no integers; inside nodes whole numbers are taken for them (ids, sizes, counts)
+//  except under these keys, which mpv always sends as doubles
+static const QSet<QString> fake_double_keys = {
+    "time", "start", "end", "cache-duration", "reader-pts", "cache-end", "fw-bytes-rate"
+};
+
+static int FakeLevel(QString name)
+{
+    for(auto &level : fake_levels)
+        if(level.first == name)
+            return level.second;
+    return -1;
+}
+
+static bool IsNumber(const QVariant &value)
+{
+    switch(int(value.type()))
+    {
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+    case QMetaType::Double:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// guess: whole doubles are integers unless the key says otherwise (json); else the types are exact
+static void ToNode(const QVariant &value, mpv_node *node, bool guess, QString key = QString())
+{
+    switch(int(value.type()))
+    {
+    case QMetaType::Bool:
+        node->format = MPV_FORMAT_FLAG;
+        node->u.flag = value.toBool();
+        break;
+    case QMetaType::Int:
+    case QMetaType::UInt:
+    case QMetaType::LongLong:
+    case QMetaType::ULongLong:
+        node->format = MPV_FORMAT_INT64;
+        node->u.int64 = value.toLongLong();
+        break;
+    case QMetaType::Double:
+    {
+        double d = value.toDouble();
+        if(guess && d == qint64(d) && !fake_double_keys.contains(key))
+        {
+            node->format = MPV_FORMAT_INT64;
+            node->u.int64 = qint64(d);
+        }
+        else
+        {
+            node->format = MPV_FORMAT_DOUBLE;
+            node->u.double_ = d;
+        }
+        break;
+    }
+    case QMetaType::QString:
+        node->format = MPV_FORMAT_STRING;
+        node->u.string = qstrdup(value.toString().toUtf8().constData());
+        break;
+    case QMetaType::QVariantList:
+    {
+        QVariantList list = value.toList();
+        node->format = MPV_FORMAT_NODE_ARRAY;
+        node->u.list = new mpv_node_list;
+        node->u.list->num = list.length();
+        node->u.list->values = new mpv_node[list.length()];
+        node->u.list->keys = nullptr;
+        for(int i = 0; i < list.length(); ++i)
+            ToNode(list[i], &node->u.list->values[i], guess, key);
+        break;
+    }
+    case QMetaType::QVariantMap:
+    {
+        QVariantMap map = value.toMap();
+        node->format = MPV_FORMAT_NODE_MAP;
+        node->u.list = new mpv_node_list;
+        node->u.list->num = map.size();
+        node->u.list->values = new mpv_node[map.size()];
+        node->u.list->keys = new char*[map.size()];
+        int i = 0;
+        for(auto iter = map.begin(); iter != map.end(); ++iter, ++i)
+        {
+            node->u.list->keys[i] = qstrdup(iter.key().toUtf8().constData());
+            ToNode(*iter, &node->u.list->values[i], guess, iter.key());
+        }
+        break;
+    }
+    default:
+        node->format = MPV_FORMAT_NONE;
+    }
+}
+
+// what a command line argument means as a property value
+static QVariant FromString(QString s)
+{
+    if(s == "yes" || s == "no")
+        return s == "yes";
+    bool ok;
+    qint64 i = s.toLongLong(&ok);
+    if(ok)
+        return i;
+    double d = s.toDouble(&ok);
+    if(ok)
+        return d;
+    return s;
+}
+
+FakeMpv::FakeMpv(QString stream):
+    wakeup(nullptr),
+    wakeupCtx(nullptr),
+    quit(false),
+    replay(false),
+    speed(1),
+    logLevel(MPV_LOG_LEVEL_NONE)
+{
+    clock.start();
+    current.event_id = MPV_EVENT_NONE;
+    // what a fresh mpv has before any file
+    properties = {
+        {"pause",           false},
+        {"speed",           1.0},
+        {"length",          0.0},
+        {"track-list",      QVariantList()},
+        {"chapter-list",    QVariantList()},
+        {"metadata",        QVariantMap()}
+    };
+    for(auto &arg : QCoreApplication::arguments())
+        if(arg.startsWith("--fake-mpv-speed=") || arg.startsWith("--replay-speed="))
+            speed = qMax(0.0, arg.section('=', 1).toDouble());
+    Parse(stream);
+}
+
+FakeMpv::~FakeMpv()
+{
+    mutex.lock();
+    quit = true;
+    condition.wakeAll();
+    mutex.unlock();
+    wait();
+    ClearCurrent();
+}
+
+void FakeMpv::Parse(QString stream)
+{
+    // problems are reported the way mpv would: as log messages once we're running
+    auto error = [&](int number, QString msg)
+    {
+        entries.append({0, MPV_EVENT_LOG_MESSAGE, "fake", QString("%0:%1: %2").arg(stream, QString::number(number), msg),
+                        MPV_LOG_LEVEL_ERROR, 1, 0, 0, 0, MPV_FORMAT_NONE, 0});
+    };
+    QFile f(stream);
+    if(!f.open(QIODevice::ReadOnly))
+    {
+        error(0, "couldn't open the stream");
+        return;
+    }
+    if(ParseRecording(f))
+        return;
+    QTextStream in(&f);
+    in.setCodec("UTF-8");
+    double at = 0;
+    for(int number = 1; !in.atEnd(); ++number)
+    {
+        QString line = in.readLine().trimmed();
+        if(line == QString() || line.startsWith('#'))
+            continue;
+        QJsonParseError parse;
+        QJsonObject object = QJsonDocument::fromJson(line.toUtf8(), &parse).object();
+        if(parse.error != QJsonParseError::NoError)
+        {
+            error(number, parse.errorString());
+            continue;
+        }
+        QString event = object["event"].toString();
+        if(!fake_events.contains(event))
+        {
+            error(number, QString("unknown event '%0'").arg(event));
+            continue;
+        }
+        // "at" is absolute; without it the event follows the one before
+        at = object["at"].toDouble(at);
+        Entry entry{at, fake_events[event], QString(), QVariant(), MPV_LOG_LEVEL_INFO,
+                    object["repeat"].toInt(1), object["rate"].toDouble(0), object["step"].toDouble(0),
+                    0, MPV_FORMAT_NONE, 0};
+        if(entry.id == MPV_EVENT_PROPERTY_CHANGE)
+        {
+            entry.name = object["name"].toString();
+            entry.value = object["value"].toVariant();
+            if(entry.name == QString())
+            {
+                error(number, "a property needs a name");
+                continue;
+            }
+        }
+        else if(entry.id == MPV_EVENT_LOG_MESSAGE)
+        {
+            entry.name = object["prefix"].toString("fake");
+            entry.value = object["text"].toString();
+            entry.level = FakeLevel(object["level"].toString("info"));
+            if(entry.level <= MPV_LOG_LEVEL_NONE)
+            {
+                error(number, QString("unknown log level '%0'").arg(object["level"].toString()));
+                continue;
+            }
+        }
+        entries.append(entry);
+    }
+}
+
+bool FakeMpv::ParseRecording(QFile &f)
+{
+    QDataStream in(&f);
+    in.setVersion(QDataStream::Qt_5_0);
+    quint32 magic = 0,
+            version = 0;
+    in >> magic >> version;
+    if(magic != RECORDING_MAGIC)
+    {
+        f.seek(0);
+        return false;
+    }
+    replay = true;
+    auto error = [&](QString msg)
+    {
+        entries.append({0, MPV_EVENT_LOG_MESSAGE, "fake", QString("%0: %1").arg(f.fileName(), msg),
+                        MPV_LOG_LEVEL_ERROR, 1, 0, 0, 0, MPV_FORMAT_NONE, 0});
+    };
+    if(version < 1 || version > RECORDING_VERSION)
+    {
+        error(QString("recording version %0 isn't supported").arg(QString::number(version)));
+        return true;
+    }
+    // the entry the player was busy with when it read a property, so the value is there in time
+    int trigger = -1;
+    while(!in.atEnd())
+    {
+        quint8 type = 0;
+        qint64 us = 0;
+        in >> type >> us;
+        Entry entry{};
+        entry.at = us/1000000.0;
+        entry.level = MPV_LOG_LEVEL_INFO;
+        entry.repeat = 1;
+        switch(type)
+        {
+        case 'e':
+        {
+            quint32 id = 0;
+            quint64 userdata = 0;
+            qint32 err = 0;
+            in >> id >> userdata >> err;
+            entry.id = mpv_event_id(id);
+            entry.userdata = userdata;
+            entry.error = err;
+            if(entry.id == MPV_EVENT_PROPERTY_CHANGE || (entry.id == MPV_EVENT_GET_PROPERTY_REPLY && version >= 2))
+            {
+                QByteArray name;
+                qint32 format = 0;
+                in >> name >> format >> entry.value;
+                entry.name = QString::fromUtf8(name);
+                entry.format = mpv_format(format);
+            }
+            else if(entry.id == MPV_EVENT_COMMAND_REPLY && version >= 2)
+                in >> entry.value;
+            else if(entry.id == MPV_EVENT_LOG_MESSAGE)
+            {
+                QByteArray prefix, text;
+                qint32 level = 0;
+                in >> prefix >> level >> text;
+                entry.name = QString::fromUtf8(prefix);
+                entry.level = level;
+                entry.value = QString::fromUtf8(text);
+            }
+            else if(entry.id == MPV_EVENT_CLIENT_MESSAGE)
+            {
+                QList<QByteArray> args;
+                in >> args;
+                QStringList list;
+                for(auto &arg : args)
+                    list.append(QString::fromUtf8(arg));
+                entry.value = list;
+            }
+            break;
+        }
+        case 'p':
+        {
+            QByteArray name;
+            qint32 err = 0;
+            in >> name;
+            if(version >= 3)
+                in >> err;
+            in >> entry.value;
+            entry.error = err;
+            entry.id = MPV_EVENT_NONE;
+            entry.name = QString::fromUtf8(name);
+            break;
+        }
+        case 'c':
+        {
+            QByteArray command;
+            in >> command;
+            entry.id = MPV_EVENT_CLIENT_MESSAGE;
+            entry.value = QStringList{"baka-replay", "command", QString::fromUtf8(command)};
+            break;
+        }
+        case 'k':
+        {
+            qint32 key = 0,
+                   modifiers = 0;
+            in >> key >> modifiers;
+            entry.id = MPV_EVENT_CLIENT_MESSAGE;
+            entry.value = QStringList{"baka-replay", "key", QString::number(key), QString::number(modifiers)};
+            break;
+        }
+        default:
+            in.setStatus(QDataStream::ReadCorruptData);
+        }
+        if(in.status() != QDataStream::Ok)
+        {
+            error("the recording is cut short or damaged");
+            break;
+        }
+        if(entry.id == MPV_EVENT_SHUTDOWN) // the replay ends the player itself, once it's reported
+            continue;
+        if(entry.id != MPV_EVENT_NONE)
+        {
+            trigger = entries.length();
+            entries.append(entry);
+        }
+        else if(trigger == -1) // read before anything happened
+            SetRead(entry);
+        else
+        {
+            entry.at = entries[trigger].at;
+            entries.insert(trigger++, entry);
+        }
+    }
+    return true;
+}
+
+int FakeMpv::Initialize()
+{
+    clock.restart();
+    start();
+    return 0;
+}
+
+void FakeMpv::run()
+{
+    QMutexLocker locker(&mutex);
+    for(auto &entry : entries)
+    {
+        for(int n = 0; n < entry.repeat; ++n)
+        {
+            if(speed > 0)
+            {
+                qint64 due = qint64((entry.at+(entry.rate > 0 ? n/entry.rate : 0))/speed*1000000000);
+                qint64 remaining;
+                while(!quit && (remaining = (due-clock.nsecsElapsed())/1000000) >= FAKE_MIN_WAIT)
+                    condition.wait(&mutex, remaining);
+            }
+            if(quit)
+                return;
+            Play(entry, n);
+        }
+    }
+    if(replay)
+        Queue({MPV_EVENT_CLIENT_MESSAGE, 0, QString(),
+               QStringList{"baka-replay", "end", QString::number(Replay::Clock())}, MPV_FORMAT_NONE, 0, 0});
+}
+
+void FakeMpv::SetRead(const Entry &entry)
+{
+    // a value the player read; its next read gets the same, or fails the same way
+    if(entry.error < 0 || !entry.value.isValid())
+    {
+        properties.remove(entry.name);
+        failed[entry.name] = entry.error < 0 ? entry.error : MPV_ERROR_PROPERTY_UNAVAILABLE;
+    }
+    else
+    {
+        properties[entry.name] = entry.value;
+        failed.remove(entry.name);
+    }
+}
+
+void FakeMpv::Play(const Entry &entry, int n)
+{
+    if(replay) // as it was, nothing more
+    {
+        switch(entry.id)
+        {
+        case MPV_EVENT_NONE:
+            SetRead(entry);
+            break;
+        case MPV_EVENT_PROPERTY_CHANGE:
+        case MPV_EVENT_GET_PROPERTY_REPLY:
+            if(entry.value.isValid())
+                properties[entry.name] = entry.value;
+            else
+                properties.remove(entry.name);
+            Queue({entry.id, entry.userdata, entry.name, entry.value, entry.format, 0, entry.error});
+            break;
+        case MPV_EVENT_CLIENT_MESSAGE:
+        {
+            QStringList args = entry.value.toStringList();
+            if(args.value(0) == "baka-replay") // when it went out, so the player can tell how late it got to it
+                args.append(QString::number(Replay::Clock()));
+            Queue({entry.id, entry.userdata, QString(), args, MPV_FORMAT_NONE, 0, entry.error});
+            break;
+        }
+        default:
+            Queue({entry.id, entry.userdata, entry.name, entry.value, MPV_FORMAT_NONE, entry.level, entry.error});
+        }
+        return;
+    }
+    switch(entry.id)
+    {
+    case MPV_EVENT_PROPERTY_CHANGE:
+    {
+        QVariant value = entry.value;
+        if(entry.step != 0 && IsNumber(value))
+        {
+            if(value.type() == QVariant::Double || entry.step != qint64(entry.step))
+                value = value.toDouble()+n*entry.step;
+            else
+                value = value.toLongLong()+n*qint64(entry.step);
+        }
+        Set(entry.name, value);
+        break;
+    }
+    case MPV_EVENT_LOG_MESSAGE:
+        Log(entry.level, entry.name, entry.value.toString());
+        break;
+    default:
+        Queue({entry.id, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    }
+}
+
+void FakeMpv::Queue(const Event &event)
+{
+    // like mpv, only wake the client when there's something new for it to drain
+    bool empty = events.isEmpty();
+    events.enqueue(event);
+    condition.wakeAll(); // a WaitEvent() with a timeout
+    if(empty && wakeup != nullptr)
+        wakeup(wakeupCtx);
+}
+
+void FakeMpv::Set(QString name, const QVariant &value)
+{
+    properties[name] = value;
+    for(auto iter = observers.begin(); iter != observers.end(); ++iter)
+        if(iter->first == name)
+            Queue({MPV_EVENT_PROPERTY_CHANGE, iter.key(), name, value, iter->second, 0, 0});
+}
+
+void FakeMpv::Log(int level, QString prefix, QString text)
+{
+    if(level > logLevel)
+        return;
+    if(!text.endsWith('\n'))
+        text += '\n';
+    Queue({MPV_EVENT_LOG_MESSAGE, 0, prefix, text, MPV_FORMAT_NONE, level, 0});
+}
+
+void FakeMpv::SetWakeupCallback(void (*callback)(void*), void *ctx)
+{
+    QMutexLocker locker(&mutex);
+    wakeup = callback;
+    wakeupCtx = ctx;
+    if(!events.isEmpty() && wakeup != nullptr) // observers queued their first values already
+        wakeup(wakeupCtx);
+}
+
+mpv_event *FakeMpv::WaitEvent(double timeout)
+{
+    QMutexLocker locker(&mutex);
+    ClearCurrent();
+    if(events.isEmpty() && timeout > 0)
+        condition.wait(&mutex, ulong(timeout*1000));
+    if(events.isEmpty())
+        return &current;
+    Event event = events.dequeue();
+    current.event_id = event.id;
+    current.error = event.error;
+    current.reply_userdata = event.userdata;
+    current.data = nullptr;
+    if(event.id == MPV_EVENT_PROPERTY_CHANGE || event.id == MPV_EVENT_GET_PROPERTY_REPLY)
+    {
+        currentName = event.name.toUtf8();
+        currentProperty.name = currentName.constData();
+        currentProperty.format = event.format;
+        currentProperty.data = &currentData;
+        if(event.format == MPV_FORMAT_NONE || !Convert(event.value, event.format, &currentData, event.name))
+        {
+            currentProperty.format = MPV_FORMAT_NONE;
+            currentProperty.data = nullptr;
+        }
+        current.data = &currentProperty;
+    }
+    else if(event.id == MPV_EVENT_LOG_MESSAGE)
+    {
+        currentPrefix = event.name.toUtf8();
+        currentText = event.value.toString().toUtf8();
+        currentLevel = "info";
+        for(auto &level : fake_levels)
+            if(level.second == event.level)
+            {
+                currentLevel = level.first.toUtf8();
+                break;
+            }
+        currentLog.prefix = currentPrefix.constData();
+        currentLog.level = currentLevel.constData();
+        currentLog.text = currentText.constData();
+        currentLog.log_level = mpv_log_level(event.level);
+        current.data = &currentLog;
+    }
+    else if(event.id == MPV_EVENT_COMMAND_REPLY)
+    {
+        currentCommand.result.format = MPV_FORMAT_NONE;
+        if(event.value.isValid())
+            ToNode(event.value, &currentCommand.result, !replay);
+        current.data = &currentCommand;
+    }
+    else if(event.id == MPV_EVENT_CLIENT_MESSAGE)
+    {
+        currentArgs.clear();
+        currentArgv.clear();
+        for(auto &arg : event.value.toStringList())
+            currentArgs.append(arg.toUtf8());
+        for(auto &arg : currentArgs)
+            currentArgv.append(arg.constData());
+        currentMessage.num_args = currentArgv.length();
+        currentMessage.args = currentArgv.data();
+        current.data = &currentMessage;
+    }
+    return &current;
+}
+
+void FakeMpv::ClearCurrent()
+{
+    if((current.event_id == MPV_EVENT_PROPERTY_CHANGE || current.event_id == MPV_EVENT_GET_PROPERTY_REPLY) &&
+       currentProperty.data != nullptr)
+    {
+        if(currentProperty.format == MPV_FORMAT_NODE)
+            FreeNodeContents(&currentData.node);
+        else if(currentProperty.format == MPV_FORMAT_STRING || currentProperty.format == MPV_FORMAT_OSD_STRING)
+            Free(currentData.string);
+    }
+    else if(current.event_id == MPV_EVENT_COMMAND_REPLY && current.data != nullptr)
+        FreeNodeContents(&currentCommand.result);
+    current.event_id = MPV_EVENT_NONE;
+    current.error = 0;
+    current.reply_userdata = 0;
+    current.data = nullptr;
+}
+
+int FakeMpv::RequestLogMessages(const char *level)
+{
+    int l = FakeLevel(QString::fromUtf8(level));
+    if(l == -1)
+        return MPV_ERROR_INVALID_PARAMETER;
+    QMutexLocker locker(&mutex);
+    logLevel = l;
+    return 0;
+}
+
+int64_t FakeMpv::GetTimeUs()
+{
+    return clock.nsecsElapsed()/1000;
+}
+
+int FakeMpv::SetOption(const char *name, mpv_format format, void *data)
+{
+    if(replay) // the recording has the values mpv ended up with
+        return 0;
+    QMutexLocker locker(&mutex);
+    properties[QString::fromUtf8(name)] = FromFormat(format, data);
+    return 0;
+}
+
+int FakeMpv::SetOptionString(const char *name, const char *data)
+{
+    if(replay)
+        return 0;
+    QMutexLocker locker(&mutex);
+    properties[QString::fromUtf8(name)] = FromString(QString::fromUtf8(data));
+    return 0;
+}
+
+int FakeMpv::Command(const char **args)
+{
+    QStringList list;
+    for(; *args != nullptr; ++args)
+        list.append(QString::fromUtf8(*args));
+    QVariant result;
+    QMutexLocker locker(&mutex);
+    return Run(list, result);
+}
+
+int FakeMpv::CommandAsync(uint64_t userdata, const char **args)
+{
+    int error = Command(args);
+    if(replay) // the reply is recorded
+        return 0;
+    QMutexLocker locker(&mutex);
+    Queue({MPV_EVENT_COMMAND_REPLY, userdata, QString(), QVariant(), MPV_FORMAT_NONE, 0, error});
+    return 0;
+}
+
+QStringList FakeMpv::Arguments(mpv_node *args)
+{
+    QStringList list;
+    for(auto &arg : MpvClient::ToVariant(*args).toList())
+        list.append(arg.toString());
+    return list;
+}
+
+int FakeMpv::CommandNode(mpv_node *args, mpv_node *result)
+{
+    QStringList list = Arguments(args);
+    QVariant value;
+    QMutexLocker locker(&mutex);
+    int error = Run(list, value);
+    if(error >= 0 && result != nullptr)
+        ToNode(value, result, !replay);
+    return error;
+}
+
+int FakeMpv::CommandNodeAsync(uint64_t userdata, mpv_node *args)
+{
+    QStringList list = Arguments(args);
+    QVariant value;
+    QMutexLocker locker(&mutex);
+    int error = Run(list, value);
+    if(!replay) // the reply is recorded
+        Queue({MPV_EVENT_COMMAND_REPLY, userdata, QString(), value, MPV_FORMAT_NONE, 0, error});
+    return 0;
+}
+
+int FakeMpv::Run(const QStringList &args, QVariant &result)
+{
+    if(args.isEmpty())
+        return MPV_ERROR_INVALID_PARAMETER;
+    // osd-msg and friends are prefixes to the command proper
+    int i = 0;
+    while(i < args.length() && QStringList{"osd-msg", "osd-auto", "no-osd", "raw", "async", "sync"}.contains(args[i]))
+        ++i;
+    QString command = args.value(i);
+    QStringList params = args.mid(i+1);
+    if(command == "show-text" || command == "expand-text")
+        result = params.value(0);
+    else if(replay) // the recording has what came of it
+        return 0;
+    else if(command == "loadfile" && !params.isEmpty())
+    {
+        if(file != QString())
+            Queue({MPV_EVENT_END_FILE, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+        file = params.front();
+        Set("path", file);
+        Set("filename", QFileInfo(file).fileName());
+        if(!properties.contains("media-title"))
+            Set("media-title", QFileInfo(file).fileName());
+        Queue({MPV_EVENT_START_FILE, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+        Queue({MPV_EVENT_FILE_LOADED, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+        Queue({MPV_EVENT_PLAYBACK_RESTART, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    }
+    else if(command == "stop")
+    {
+        if(file != QString())
+            Queue({MPV_EVENT_END_FILE, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+        file = QString();
+        Queue({MPV_EVENT_IDLE, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    }
+    else if(command == "quit")
+        Queue({MPV_EVENT_SHUTDOWN, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    else if((command == "set" && params.length() >= 2) || command == "cycle" || command == "add")
+    {
+        if(params.isEmpty())
+            return MPV_ERROR_INVALID_PARAMETER;
+        QString name = params.front();
+        QVariant value = properties.value(name);
+        if(command == "set")
+            value = FromString(params[1]);
+        else if(value.type() == QVariant::Bool)
+            value = !value.toBool();
+        else if(IsNumber(value) || command == "add")
+            value = value.toDouble()+(params.length() > 1 ? params[1].toDouble() : 1);
+        else
+            return MPV_ERROR_PROPERTY_UNAVAILABLE;
+        Set(name, value);
+        if(name == "pause")
+            Queue({value.toBool() ? MPV_EVENT_PAUSE : MPV_EVENT_UNPAUSE, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    }
+    // everything else is taken and does nothing
+    return 0;
+}
+
+int FakeMpv::GetProperty(const char *name, mpv_format format, void *data)
+{
+    QMutexLocker locker(&mutex);
+    QString key = QString::fromUtf8(name);
+    if(!properties.contains(key))
+    {
+        if(format == MPV_FORMAT_NODE)
+            static_cast<mpv_node*>(data)->format = MPV_FORMAT_NONE;
+        return failed.value(key, MPV_ERROR_PROPERTY_UNAVAILABLE);
+    }
+    if(!Convert(properties[key], format, data, key))
+        return MPV_ERROR_PROPERTY_FORMAT;
+    return 0;
+}
+
+char *FakeMpv::GetPropertyString(const char *name)
+{
+    char *s = nullptr;
+    if(GetProperty(name, MPV_FORMAT_STRING, &s) < 0)
+        return nullptr;
+    return s;
+}
+
+int FakeMpv::GetPropertyAsync(uint64_t userdata, const char *name, mpv_format format)
+{
+    if(replay) // the reply is recorded
+        return 0;
+    QMutexLocker locker(&mutex);
+    QString key = QString::fromUtf8(name);
+    if(!properties.contains(key))
+        Queue({MPV_EVENT_GET_PROPERTY_REPLY, userdata, key, QVariant(), MPV_FORMAT_NONE, 0, MPV_ERROR_PROPERTY_UNAVAILABLE});
+    else
+        Queue({MPV_EVENT_GET_PROPERTY_REPLY, userdata, key, properties[key], format, 0, 0});
+    return 0;
+}
+
+int FakeMpv::SetPropertyString(const char *name, const char *data)
+{
+    const char *args[] = {"set", name, data, nullptr};
+    return Command(args);
+}
+
+int FakeMpv::SetPropertyAsync(uint64_t userdata, const char *name, mpv_format format, void *data)
+{
+    if(replay)
+        return 0;
+    QMutexLocker locker(&mutex);
+    QString key = QString::fromUtf8(name);
+    QVariant value = FromFormat(format, data);
+    Set(key, value);
+    if(key == "pause")
+        Queue({value.toBool() ? MPV_EVENT_PAUSE : MPV_EVENT_UNPAUSE, 0, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    Queue({MPV_EVENT_SET_PROPERTY_REPLY, userdata, QString(), QVariant(), MPV_FORMAT_NONE, 0, 0});
+    return 0;
+}
+
+int FakeMpv::ObserveProperty(uint64_t userdata, const char *name, mpv_format format)
+{
+    QMutexLocker locker(&mutex);
+    QString key = QString::fromUtf8(name);
+    observers.insertMulti(userdata, {key, format});
+    // mpv starts every observer off with the current value; replays have it recorded
+    if(!replay)
+        Queue({MPV_EVENT_PROPERTY_CHANGE, userdata, key, properties.value(key), format, 0, 0});
+    return 0;
+}
+
+int FakeMpv::UnobserveProperty(uint64_t userdata)
+{
+    QMutexLocker locker(&mutex);
+    return observers.remove(userdata);
+}
+
+bool FakeMpv::Convert(const QVariant &value, mpv_format format, void *data, QString key)
+{
+    if(!value.isValid())
+        return false;
+    bool ok = true;
+    switch(format)
+    {
+    case MPV_FORMAT_STRING:
+    case MPV_FORMAT_OSD_STRING:
+    {
+        QString s;
+        if(value.type() == QVariant::Bool)
+            s = value.toBool() ? "yes" : "no";
+        else if(value.type() == QVariant::List || value.type() == QVariant::Map)
+            s = QString::fromUtf8(QJsonDocument::fromVariant(value).toJson(QJsonDocument::Compact));
+        else
+            s = value.toString();
+        *static_cast<char**>(data) = qstrdup(s.toUtf8().constData());
+        return true;
+    }
+    case MPV_FORMAT_FLAG:
+        if(value.type() != QVariant::Bool && !IsNumber(value))
+            return false;
+        *static_cast<int*>(data) = value.toBool();
+        return true;
+    case MPV_FORMAT_INT64:
+        *static_cast<int64_t*>(data) = value.toLongLong(&ok);
+        return ok && IsNumber(value);
+    case MPV_FORMAT_DOUBLE:
+        *static_cast<double*>(data) = value.toDouble(&ok);
+        return ok && IsNumber(value);
+    case MPV_FORMAT_NODE:
+        ToNode(value, static_cast<mpv_node*>(data), !replay, key);
+        return true;
+    default:
+        return false;
+    }
+}
+
+QVariant FakeMpv::FromFormat(mpv_format format, void *data)
+{
+    if(format == MPV_FORMAT_STRING || format == MPV_FORMAT_OSD_STRING)
+        return FromString(QString::fromUtf8(*static_cast<char**>(data)));
+    return MpvClient::ToVariant(format, data);
+}
+
+void FakeMpv::FreeNodeContents(mpv_node *node)
+{
+    if(node->format == MPV_FORMAT_STRING)
+        delete [] node->u.string;
+    else if(node->format == MPV_FORMAT_NODE_ARRAY || node->format == MPV_FORMAT_NODE_MAP)
+    {
+        for(int i = 0; i < node->u.list->num; ++i)
+        {
+            FreeNodeContents(&node->u.list->values[i]);
+            if(node->u.list->keys != nullptr)
+                delete [] node->u.list->keys[i];
+        }
+        delete [] node->u.list->values;
+        delete [] node->u.list->keys;
+        delete node->u.list;
+    }
+    node->format = MPV_FORMAT_NONE;
+}
+
+void FakeMpv::Free(void *data)
+{
+    delete [] static_cast<char*>(data);
+}
@@ -0,0 +1,147 @@
+#ifndef FAKEMPV_H
+#define FAKEMPV_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+#include <QHash>
+#include <QList>
+#include <QQueue>
+#include <QPair>
+#include <QVector>
+#include <QByteArray>
+
+#include "mpvclient.h"
+
+class QFile;
+
+// --fake-mpv=<stream>: an mpv that plays back a script of events instead of media.
+//  the stream is json lines, each an event at a time (property changes, file-loaded, log
+//  messages...) that can repeat at a rate, so the handler and the gui can be driven
+//  deterministically, without media or a gpu, and flooded to find out where they give.
+//  --fake-mpv-speed=<factor> scales the timing; 0 plays everything as fast as it can.
+// commands get just enough of a response (loadfile, stop, set, cycle, add, quit) for the
+//  player to go through its states. see README.md for the stream format.
+// --replay=<recording> plays back a --record file (see recording.h) instead: everything mpv
+//  sent, as it was sent, with the property values the player read. commands change nothing
+//  here, the recording has what they led to; the recorded commands and key presses go to the
+//  player as "baka-replay" client messages, in line with the events (see replay.h).
+//  --replay-speed=<factor> works like --fake-mpv-speed.
+class FakeMpv : public QThread, public MpvClient
+{
+public:
+    explicit FakeMpv(QString stream);
+    ~FakeMpv();
+
+    int Initialize();
+    void SetWakeupCallback(void (*callback)(void*), void *ctx);
+    mpv_event *WaitEvent(double timeout);
+    int RequestLogMessages(const char *level);
+    int64_t GetTimeUs();
+
+    int SetOption(const char *name, mpv_format format, void *data);
+    int SetOptionString(const char *name, const char *data);
+
+    int Command(const char **args);
+    int CommandAsync(uint64_t userdata, const char **args);
+    int CommandNode(mpv_node *args, mpv_node *result);
+    int CommandNodeAsync(uint64_t userdata, mpv_node *args);
+
+    int GetProperty(const char *name, mpv_format format, void *data);
+    char *GetPropertyString(const char *name);
+    int GetPropertyAsync(uint64_t userdata, const char *name, mpv_format format);
+    int SetPropertyString(const char *name, const char *data);
+    int SetPropertyAsync(uint64_t userdata, const char *name, mpv_format format, void *data);
+    int ObserveProperty(uint64_t userdata, const char *name, mpv_format format);
+    int UnobserveProperty(uint64_t userdata);
+
+    void FreeNodeContents(mpv_node *node);
+    void Free(void *data);
+
+protected:
+    void run(); // plays the stream
+
+private:
+    struct Entry
+    {
+        double at;          // seconds after Initialize()
+        mpv_event_id id;    // none: a property value that was read, with no event
+        QString name;       // property, or log prefix
+        QVariant value;     // property value, log text, or client message arguments
+        int level;          // log messages
+        int repeat;
+        double rate;        // repeats per second; 0 is all at once
+        double step;        // added to a numeric value with each repeat
+        // replays: as recorded
+        uint64_t userdata;
+        mpv_format format;
+        int error;
+    };
+    struct Event
+    {
+        mpv_event_id id;
+        uint64_t userdata;
+        QString name;
+        QVariant value;     // command replies: the result
+        mpv_format format;  // properties: what the observer asked for
+        int level;
+        int error;
+    };
+
+    void Parse(QString stream);
+    bool ParseRecording(QFile &f);
+    QStringList Arguments(mpv_node *args);
+    void Play(const Entry &entry, int n);
+    void SetRead(const Entry &entry);   // replays: a recorded read
+    void Queue(const Event &event);
+    void Set(QString name, const QVariant &value);
+    void Log(int level, QString prefix, QString text);
+    int Run(const QStringList &args, QVariant &result);
+
+    bool Convert(const QVariant &value, mpv_format format, void *data, QString key = QString());
+    QVariant FromFormat(mpv_format format, void *data);
+    void ClearCurrent();
+
+    QMutex mutex;
+    QWaitCondition condition;
+    QElapsedTimer clock;
+    QList<Entry> entries;
+    QQueue<Event> events;
+    QHash<QString, QVariant> properties;
+    QHash<QString, int> failed;         // replays: properties whose recorded read failed, and how
+    QHash<uint64_t, QPair<QString, mpv_format>> observers;
+    void (*wakeup)(void*);
+    void *wakeupCtx;
+    bool quit,
+         replay;            // playing a recording
+    double speed;
+    int logLevel;
+    QString file;           // loaded, if any
+
+    // the event WaitEvent() returned last, and what it points to
+    mpv_event current;
+    mpv_event_property currentProperty;
+    mpv_event_log_message currentLog;
+    mpv_event_client_message currentMessage;
+    mpv_event_command currentCommand;
+    QList<QByteArray> currentArgs;
+    QVector<const char*> currentArgv;
+    QByteArray currentName,
+               currentPrefix,
+               currentLevel,
+               currentText;
+    union
+    {
+        char *string;
+        int flag;
+        int64_t int64;
+        double double_;
+        mpv_node node;
+    } currentData;
+};
+
+#endif // FAKEMPV_H
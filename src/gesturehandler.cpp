@@ -71,16 +71,28 @@ bool GestureHandler::Process(QPoint mousePos)
                 else if(abs(delta.y()) >= abs(delta.x()) + gesture_threshold)
                     gesture_state = ADJUSTING_VOLUME;
                 break;
+            // as the commands that do the same, so they're recorded like the rest of the input
             case SEEKING:
             {
-                int relative = delta.x() * hRatio;
-                baka->mpv->Seek(start.time + relative, false, true);
+                int pos = start.time + int(delta.x() * hRatio);
+                baka->Dispatch(QString("mpv osd-msg seek %0 absolute").arg(QString::number(pos)),
+                               [=]
+                               {
+                                   baka->mpv->Seek(pos, false, true);
+                               });
                 break;
             }
             case ADJUSTING_VOLUME:
-                baka->mpv->Volume(start.volume - delta.y() * vRatio, true);
+            {
+                int volume = start.volume - delta.y() * vRatio;
+                baka->Dispatch(QString("volume %0").arg(QString::number(volume)),
+                               [=]
+                               {
+                                   baka->mpv->Volume(volume, true);
+                               });
                 break;
             }
+            }
         }
 
         elapsedTimer->restart();
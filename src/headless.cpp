@@ -0,0 +1,166 @@
+#include "headless.h"
+
+#include <QCoreApplication>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "bakaengine.h"
+#include "mpvhandler.h"
+#include "thumbnailhandler.h"
+#include "waveformhandler.h"
+#include "ui/mainwindow.h"
+#include "ui_mainwindow.h"
+#include "util.h"
+
+#define HEADLESS_SAMPLE_RATE 10 // ms between event loop latency probes
+
+bool Headless::Requested()
+{
+    return QCoreApplication::arguments().contains("--headless");
+}
+
+void Headless::Prepare()
+{
+    qputenv("QT_QPA_PLATFORM", "offscreen");
+}
+
+Headless::Headless(QObject *parent):
+    QObject(parent),
+    baka(static_cast<BakaEngine*>(parent)),
+    sampler(new QTimer(this)),
+    loadTime(0),
+    frameTime(0),
+    frames(0),
+    sampling(false),
+    firstLoad(0),
+    lastEnd(0),
+    totalFrames(0),
+    totalSeconds(0),
+    opened(0),
+    failed(0)
+{
+    clock.start();
+    lastSample = clock.nsecsElapsed();
+    connect(sampler, &QTimer::timeout,
+            this, &Headless::Sample);
+    connect(baka->mpv, &MpvHandler::playStateChanged,
+            this, &Headless::PlayStateChanged);
+    connect(baka->mpv, &MpvHandler::playbackRestarted,
+            this, &Headless::PlaybackRestarted);
+    connect(qApp, &QCoreApplication::aboutToQuit,
+            this, &Headless::Finish);
+    // a script decides for itself when it's done
+    bool scripted = false;
+    for(auto &arg : QCoreApplication::arguments())
+        scripted = scripted || arg.startsWith("--script=");
+    if(!scripted)
+        connect(baka->window, &MainWindow::playlistFinished,
+                qApp, &QCoreApplication::quit);
+    sampler->start(HEADLESS_SAMPLE_RATE);
+}
+
+void Headless::Configure()
+{
+    baka->mpv->SetOption("vo", "null");
+    baka->mpv->SetOption("ao", "null");
+    baka->mpv->SetOption("untimed", "yes");
+    // a run has to reach the end of the playlist to finish (playlistFinished); no looping,
+    //  whatever the settings' mpv options or the repeat menu say
+    baka->mpv->SetOption("loop-playlist", "no");
+    baka->mpv->SetOption("loop-file", "no");
+    baka->window->ui->action_Off->setChecked(true);
+    baka->window->ui->action_This_File->setChecked(false);
+    baka->window->ui->action_Playlist->setChecked(false);
+    // they'd decode the same files again behind our back
+    baka->thumbnail->setEnabled(false);
+    baka->waveform->setEnabled(false);
+}
+
+void Headless::PlayStateChanged(Mpv::PlayState playState)
+{
+    if(playState == Mpv::Loaded) // the file's been handed to mpv
+    {
+        EndFile();
+        file = baka->mpv->getPath()+baka->mpv->getFile();
+        loadTime = clock.nsecsElapsed();
+        frameTime = 0;
+        frames = 0;
+        if(opened+failed == 0)
+            firstLoad = loadTime;
+    }
+    else if(playState == Mpv::Stopped)
+        EndFile();
+}
+
+void Headless::PlaybackRestarted()
+{
+    if(file == QString() || frameTime != 0) // seeks restart playback too
+        return;
+    frameTime = clock.nsecsElapsed();
+    ttff.append((frameTime-loadTime)/1000000.0);
+}
+
+void Headless::Sample()
+{
+    // the timer fires late by however long the event loop was busy
+    qint64 now = clock.nsecsElapsed();
+    latency.append(qMax(0.0, (now-lastSample)/1000000.0-HEADLESS_SAMPLE_RATE));
+    lastSample = now;
+    // one read in flight at a time; if mpv is slow to answer the samples don't pile up on it
+    if(frameTime != 0 && !sampling)
+    {
+        qint64 load = loadTime;
+        sampling = true;
+        baka->mpv->GetPropertyAsync("estimated-frame-number",
+                                    [=](int error, const QVariant &value)
+                                    {
+                                        sampling = false;
+                                        if(error >= 0 && loadTime == load) // still the same file
+                                            frames = value.toLongLong();
+                                    });
+    }
+}
+
+void Headless::EndFile()
+{
+    if(file == QString())
+        return;
+    lastEnd = clock.nsecsElapsed();
+    QJsonObject result;
+    result["file"] = file;
+    if(frameTime == 0)
+    {
+        result["error"] = QString("no frame");
+        ++failed;
+    }
+    else
+    {
+        double seconds = (lastEnd-frameTime)/1000000000.0;
+        result["ttff_ms"] = (frameTime-loadTime)/1000000.0;
+        result["seconds"] = seconds;
+        result["frames"] = frames;
+        result["fps"] = seconds > 0 ? frames/seconds : 0;
+        totalFrames += frames;
+        totalSeconds += seconds;
+        ++opened;
+    }
+    (qStdout() << QJsonDocument(result).toJson(QJsonDocument::Compact) << "\n").flush();
+    file = QString();
+}
+
+void Headless::Finish()
+{
+    EndFile();
+    sampler->stop();
+    double elapsed = (lastEnd-firstLoad)/1000000000.0;
+    QJsonObject summary;
+    summary["files"] = opened+failed;
+    summary["failed"] = failed;
+    summary["files_per_sec"] = elapsed > 0 ? (opened+failed)/elapsed : 0;
+    summary["fps"] = totalSeconds > 0 ? totalFrames/totalSeconds : 0;
+    summary["ttff_ms"] = Util::Stats(ttff);
+    summary["latency_ms"] = Util::Stats(latency);
+    QJsonObject root;
+    root["summary"] = summary;
+    (qStdout() << QJsonDocument(root).toJson(QJsonDocument::Compact) << "\n").flush();
+}
@@ -0,0 +1,60 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <QObject>
+#include <QString>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "mpvtypes.h"
+
+class BakaEngine;
+
+// --headless: a perf harness for machines without a display or gpu.
+//  the window goes to the offscreen qpa, mpv gets vo=null, ao=null and untimed, so files
+//  play as fast as they decode. each file is reported as a json line on stdout, and a
+//  summary (files/sec, time to first frame, decode fps, event loop latency) at exit.
+// without --script it plays what it was given to the end of the playlist (never looping) and quits.
+class Headless : public QObject
+{
+    Q_OBJECT
+public:
+    static bool Requested(); // --headless on the command line
+    static void Prepare();   // before the QApplication exists
+
+    explicit Headless(QObject *parent = 0);
+
+    void Configure();        // after the settings are applied, before mpv->Initialize()
+
+private slots:
+    void PlayStateChanged(Mpv::PlayState playState);
+    void PlaybackRestarted();
+    void Sample();
+    void Finish();
+
+private:
+    void EndFile();
+
+    BakaEngine *baka;
+    QElapsedTimer clock;
+    QTimer *sampler;
+    qint64 lastSample;
+    QVector<double> latency,    // ms the event loop was late for each sample
+                    ttff;       // ms from load to first frame, per file
+    // the file being played
+    QString file;
+    qint64 loadTime,            // ns, on clock
+           frameTime;           // ns, 0 until the first frame
+    qint64 frames;              // as of the last sample
+    bool sampling;              // a frame count read is out
+    // totals
+    qint64 firstLoad,
+           lastEnd,
+           totalFrames;
+    double totalSeconds;        // playing time the frames were decoded in
+    int opened,
+        failed;
+};
+
+#endif // HEADLESS_H
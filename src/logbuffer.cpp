@@ -0,0 +1,126 @@
+#include "logbuffer.h"
+
+#include <QtGlobal>
+
+#include <cstdint>
+#include <utility> // for std::move
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#define DUMP_WRITE _write
+#else
+#include <unistd.h>
+#define DUMP_WRITE write
+#endif
+
+LogBuffer::LogBuffer(size_t capacity):
+    enqueuePos(0),
+    dequeuePos(0),
+    dropped(0)
+{
+    size_t size = 2;
+    while(size < capacity)
+        size <<= 1;
+    mask = size-1;
+    ring = new Slot[size];
+    for(size_t i = 0; i < size; ++i)
+        ring[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+LogBuffer::~LogBuffer()
+{
+    delete [] ring;
+}
+
+bool LogBuffer::push(const QString &message)
+{
+    Slot *slot;
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    forever
+    {
+        slot = &ring[pos & mask];
+        size_t seq = slot->sequence.load(std::memory_order_acquire);
+        intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+        if(dif == 0) // slot is free, try to claim it
+        {
+            if(enqueuePos.compare_exchange_weak(pos, pos+1, std::memory_order_relaxed))
+                break;
+        }
+        else if(dif < 0) // full; the consumer hasn't caught up
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        else // another producer got it first
+            pos = enqueuePos.load(std::memory_order_relaxed);
+    }
+    slot->message = message;
+    slot->sequence.store(pos+1, std::memory_order_release); // publish
+    return true;
+}
+
+bool LogBuffer::pop(QString &message)
+{
+    Slot *slot = &ring[dequeuePos & mask];
+    if(slot->sequence.load(std::memory_order_acquire) != dequeuePos+1) // empty (or not yet published)
+        return false;
+    message = std::move(slot->message);
+    slot->message = QString();
+    slot->sequence.store(dequeuePos+mask+1, std::memory_order_release); // hand the slot back to producers
+    ++dequeuePos;
+    return true;
+}
+
+void LogBuffer::dump(int fd) const
+{
+    // for crash handlers: no locks, no allocation, just the bytes of whatever's been published
+    //  and not popped yet. a consumer running at the same time can make us miss or repeat one
+    char buffer[1024];
+    size_t n = 0;
+    for(size_t pos = dequeuePos; pos != dequeuePos+mask+1; ++pos)
+    {
+        const Slot &slot = ring[pos & mask];
+        if(slot.sequence.load(std::memory_order_acquire) != pos+1)
+            break;
+        const ushort *s = slot.message.utf16();
+        int length = slot.message.size();
+        for(int i = 0; i < length; ++i)
+        {
+            if(n+4 > sizeof(buffer))
+            {
+                DUMP_WRITE(fd, buffer, n);
+                n = 0;
+            }
+            uint c = s[i];
+            if(c >= 0xd800 && c < 0xdc00 && i+1 < length && s[i+1] >= 0xdc00 && s[i+1] < 0xe000)
+                c = 0x10000 + ((c-0xd800) << 10) + (s[++i]-0xdc00);
+            if(c < 0x80)
+                buffer[n++] = char(c);
+            else if(c < 0x800)
+            {
+                buffer[n++] = char(0xc0 | (c >> 6));
+                buffer[n++] = char(0x80 | (c & 0x3f));
+            }
+            else if(c < 0x10000)
+            {
+                buffer[n++] = char(0xe0 | (c >> 12));
+                buffer[n++] = char(0x80 | ((c >> 6) & 0x3f));
+                buffer[n++] = char(0x80 | (c & 0x3f));
+            }
+            else
+            {
+                buffer[n++] = char(0xf0 | (c >> 18));
+                buffer[n++] = char(0x80 | ((c >> 12) & 0x3f));
+                buffer[n++] = char(0x80 | ((c >> 6) & 0x3f));
+                buffer[n++] = char(0x80 | (c & 0x3f));
+            }
+        }
+    }
+    if(n > 0)
+        DUMP_WRITE(fd, buffer, n);
+}
+
+quint64 LogBuffer::takeDropped()
+{
+    return dropped.exchange(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,37 @@
+#ifndef LOGBUFFER_H
+#define LOGBUFFER_H
+
+#include <QString>
+
+#include <atomic>
+#include <cstddef>
+
+// bounded lock-free multi-producer single-consumer ring of log messages
+//  (Dmitry Vyukov's bounded queue; every slot carries a sequence number)
+// producers never block: when the ring is full the message is dropped and counted
+class LogBuffer
+{
+public:
+    explicit LogBuffer(size_t capacity); // rounded up to a power of 2
+    ~LogBuffer();
+
+    bool push(const QString &message);   // any thread
+    bool pop(QString &message);          // consumer thread only
+    quint64 takeDropped();               // dropped messages since the last call
+    void dump(int fd) const;             // async-signal-safe: writes what's queued to fd as utf-8, leaves it queued
+
+private:
+    struct Slot
+    {
+        std::atomic<size_t> sequence;
+        QString message;
+    };
+
+    Slot *ring;
+    size_t mask;
+    std::atomic<size_t> enqueuePos;
+    size_t dequeuePos;
+    std::atomic<quint64> dropped;
+};
+
+#endif // LOGBUFFER_H
@@ -0,0 +1,292 @@
+#include "logfile.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QMutexLocker>
+
+#include <algorithm> // for std::find
+#include <iterator> // for std::begin, std::end
+#include <csignal>
+#include <fcntl.h>
+
+#if defined(Q_OS_WIN)
+#include <io.h>
+#include <sys/stat.h>
+#define CRASH_OPEN(path) _open(path, _O_WRONLY | _O_APPEND | _O_CREAT | _O_BINARY, _S_IREAD | _S_IWRITE)
+#define CRASH_WRITE _write
+#define CRASH_CLOSE _close
+#else
+#include <unistd.h>
+#define CRASH_OPEN(path) open(path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0644)
+#define CRASH_WRITE write
+#define CRASH_CLOSE close
+#endif
+
+#include "logbuffer.h"
+#include "tracing.h"
+
+#define LOG_WRITE_SIZE 64*1024  // bytes queued before the worker writes them out
+#define LOG_WRITE_RATE 1000     // ms the worker holds on to anything less than that
+
+LogFile *LogFile::instance = nullptr;
+
+// whoever handled these before us; the crash handler hands the signal on to them
+static const int crashSignals[] = {SIGSEGV, SIGABRT, SIGFPE, SIGILL};
+#if defined(Q_OS_UNIX)
+static struct sigaction previous[sizeof(crashSignals)/sizeof(int)];
+#else
+static void (*previous[sizeof(crashSignals)/sizeof(int)])(int);
+#endif
+
+LogFile::LogFile(QObject *parent):
+    QThread(parent)
+{
+    instance = this;
+    for(int sig : crashSignals)
+        InstallCrashHandler(sig);
+}
+
+LogFile::~LogFile()
+{
+    mutex.lock();
+    quit = true;
+    condition.wakeAll();
+    mutex.unlock();
+    wait();
+    instance = nullptr;
+    SetCrashFd(-1);
+}
+
+QString LogFile::DefaultFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::DataLocation)+"/logs/baka-mplayer.log";
+}
+
+void LogFile::setEnabled(bool b)
+{
+    QMutexLocker lock(&mutex);
+    enabled = b;
+    reopen = true;
+    if(enabled && !isRunning()) // the worker is only started once it's needed
+        start(QThread::LowPriority);
+    condition.wakeAll();
+}
+
+void LogFile::setFile(QString f)
+{
+    QMutexLocker lock(&mutex);
+    file = f;
+    reopen = true;
+    condition.wakeAll();
+}
+
+void LogFile::setRotation(qint64 size, int age, int count, bool z)
+{
+    QMutexLocker lock(&mutex);
+    maxSize = size;
+    maxAge = age;
+    keep = count;
+    compress = z;
+}
+
+void LogFile::write(const QString &text)
+{
+    if(!enabled) // only ever changed from this thread
+        return;
+    QByteArray data = text.toUtf8();
+    QMutexLocker lock(&mutex);
+    while(pendingBusy.test_and_set(std::memory_order_acquire)); // only ever held by a crash, which doesn't give it back
+    pending += data;
+    pendingBusy.clear(std::memory_order_release);
+    if(pending.size() >= LOG_WRITE_SIZE)
+        condition.wakeAll();
+}
+
+void LogFile::flush()
+{
+    BAKA_TRACE("LogFile::flush");
+    QMutexLocker lock(&mutex);
+    if(!isRunning())
+        return;
+    int target = ++requested;
+    condition.wakeAll();
+    while(done < target && isRunning())
+        flushed.wait(&mutex, LOG_WRITE_RATE);
+}
+
+void LogFile::run()
+{
+    forever
+    {
+        mutex.lock();
+        // wait for a full chunk, a flush, or for the timer to run out on a partial one
+        if(!quit && !reopen && requested == done && pending.size() < LOG_WRITE_SIZE)
+            condition.wait(&mutex, LOG_WRITE_RATE);
+        QByteArray data;
+        while(pendingBusy.test_and_set(std::memory_order_acquire));
+        data.swap(pending);
+        pendingBusy.clear(std::memory_order_release);
+        bool stop = quit,
+             on = enabled;
+        if(reopen)
+        {
+            reopen = false;
+            out.close();
+            outFile = file == QString() ? DefaultFile() : file;
+        }
+        qint64 size = maxSize;
+        int age = maxAge,
+            target = requested;
+        mutex.unlock();
+
+        if(on && !data.isEmpty())
+        {
+            if(!out.isOpen())
+                Open();
+            if(out.isOpen())
+            {
+                if((size > 0 && out.size()+data.size() > size) ||
+                   (age > 0 && opened.secsTo(QDateTime::currentDateTime()) > age*3600))
+                {
+                    Rotate();
+                    Open();
+                }
+                out.write(data);
+                out.flush();
+            }
+        }
+        else if(!on && out.isOpen())
+        {
+            out.close();
+            SetCrashFd(-1);
+        }
+
+        mutex.lock();
+        done = target;
+        flushed.wakeAll();
+        mutex.unlock();
+
+        if(stop)
+            break;
+    }
+    out.close();
+    SetCrashFd(-1);
+}
+
+void LogFile::Open()
+{
+    QDir().mkpath(QFileInfo(outFile).absolutePath());
+    out.setFileName(outFile);
+    if(!out.open(QIODevice::WriteOnly | QIODevice::Append))
+        return;
+    SetCrashFd(CRASH_OPEN(QFile::encodeName(outFile).constData()));
+    // an existing log keeps its age across restarts; where the file system can't say when
+    //  it was created, the last write is as close as we get
+    opened = QDateTime::currentDateTime();
+    if(out.size() > 0)
+    {
+        QFileInfo info(outFile);
+#if QT_VERSION >= QT_VERSION_CHECK(5, 10, 0)
+        QDateTime born = info.birthTime();
+#else
+        QDateTime born = info.created();
+#endif
+        opened = born.isValid() ? born : info.lastModified();
+    }
+}
+
+void LogFile::SetCrashFd(int fd)
+{
+    int old = crashFd.exchange(fd);
+    if(old >= 0)
+        CRASH_CLOSE(old);
+}
+
+void LogFile::Rotate()
+{
+    out.close();
+
+    mutex.lock();
+    int count = keep;
+    bool z = compress;
+    mutex.unlock();
+
+    // shift log.1 -> log.2, ...; whatever falls past keep is deleted
+    QFile::remove(Rotated(count, false));
+    QFile::remove(Rotated(count, true));
+    for(int i = count-1; i >= 1; --i)
+    {
+        if(QFile::exists(Rotated(i, true)))
+            QFile::rename(Rotated(i, true), Rotated(i+1, true));
+        else if(QFile::exists(Rotated(i, false)))
+            QFile::rename(Rotated(i, false), Rotated(i+1, false));
+    }
+
+    if(count < 1)
+        QFile::remove(outFile);
+    else if(z)
+    {
+        // zlib via qCompress; read back with qUncompress
+        QFile in(outFile);
+        QSaveFile archive(Rotated(1, true));
+        if(in.open(QIODevice::ReadOnly) && archive.open(QIODevice::WriteOnly))
+        {
+            archive.write(qCompress(in.readAll(), 9));
+            in.close();
+            if(archive.commit())
+                QFile::remove(outFile);
+        }
+        if(QFile::exists(outFile)) // couldn't compress it; keep it as is
+            QFile::rename(outFile, Rotated(1, false));
+    }
+    else
+        QFile::rename(outFile, Rotated(1, false));
+}
+
+QString LogFile::Rotated(int i, bool z)
+{
+    return QString("%0.%1%2").arg(outFile, QString::number(i), z ? ".z" : "");
+}
+
+void LogFile::InstallCrashHandler(int sig)
+{
+    int i = std::find(std::begin(crashSignals), std::end(crashSignals), sig)-std::begin(crashSignals);
+#if defined(Q_OS_UNIX)
+    struct sigaction action;
+    action.sa_handler = &LogFile::CrashHandler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESETHAND; // a crash inside the handler goes straight to the default
+    sigaction(sig, &action, &previous[i]);
+#else
+    previous[i] = std::signal(sig, &LogFile::CrashHandler);
+#endif
+}
+
+void LogFile::CrashHandler(int sig)
+{
+    // async-signal-safe only: atomics and write(2) on a descriptor opened beforehand.
+    //  what the worker hasn't written yet goes first, then what the gui hasn't flushed from the ring
+    LogFile *log = instance;
+    int fd = log != nullptr ? log->crashFd.load() : -1;
+    if(fd >= 0)
+    {
+        if(!log->pendingBusy.test_and_set(std::memory_order_acquire)) // left set; we're going down
+        {
+            if(!log->pending.isEmpty())
+                CRASH_WRITE(fd, log->pending.constData(), log->pending.size());
+        }
+        if(log->ring != nullptr)
+            log->ring->dump(fd);
+    }
+
+    // hand it on to whoever was there before us; the signal is delivered again once we return
+    int i = std::find(std::begin(crashSignals), std::end(crashSignals), sig)-std::begin(crashSignals);
+#if defined(Q_OS_UNIX)
+    sigaction(sig, &previous[i], nullptr);
+#else
+    std::signal(sig, previous[i] != nullptr && previous[i] != SIG_ERR ? previous[i] : SIG_DFL);
+#endif
+    std::raise(sig);
+}
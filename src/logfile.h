@@ -0,0 +1,84 @@
+#ifndef LOGFILE_H
+#define LOGFILE_H
+
+#include <QThread>
+#include <QString>
+#include <QByteArray>
+#include <QDateTime>
+#include <QFile>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <atomic>
+
+class LogBuffer;
+
+// log file sink; text is queued by the gui thread and written out by a worker
+//  in large chunks, rotating by size and/or age
+class LogFile : public QThread
+{
+    Q_OBJECT
+public:
+    explicit LogFile(QObject *parent = 0);
+    ~LogFile(); // writes out everything still queued
+
+    bool getEnabled()       { return enabled; }
+    QString getFile()       { return file; }
+    qint64 getMaxSize()     { return maxSize; }
+    int getMaxAge()         { return maxAge; }
+    int getKeep()           { return keep; }
+    bool getCompress()      { return compress; }
+
+    QString DefaultFile();
+    void setRing(LogBuffer *r) { ring = r; } // what the crash handler drains besides our own queue
+
+public slots:
+    void setEnabled(bool b);
+    void setFile(QString f); // empty file is the default location
+    void setRotation(qint64 size, int age, int count, bool z); // size in bytes, age in hours; 0 disables
+    void write(const QString &text);
+    void flush(); // blocks until everything written so far is on disk
+
+protected:
+    void run();
+
+    void Open();
+    void Rotate();
+    QString Rotated(int i, bool z);
+    void SetCrashFd(int fd);
+
+    static void CrashHandler(int sig);
+    static void InstallCrashHandler(int sig);
+
+private:
+    // shared with the worker thread, guarded by mutex
+    QMutex mutex;
+    QWaitCondition condition,
+                   flushed;
+    QByteArray pending;
+    QString file;
+    qint64 maxSize = 0;
+    int maxAge = 0,
+        keep = 0,
+        requested = 0,  // flush requests made
+        done = 0;       // flush requests handled
+    bool enabled = false,
+         compress = false,
+         reopen = false,
+         quit = false;
+
+    // worker thread only
+    QFile out;
+    QString outFile;
+    QDateTime opened;
+
+    // for the crash handler, which can't take locks or allocate: pending is only touched with
+    //  pendingBusy set, and crashFd is a descriptor of its own on the file being written
+    std::atomic_flag pendingBusy = ATOMIC_FLAG_INIT;
+    std::atomic<int> crashFd{-1};
+    LogBuffer *ring = nullptr;
+
+    static LogFile *instance;
+};
+
+#endif // LOGFILE_H
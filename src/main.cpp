@@ -3,6 +3,12 @@
 #include <QApplication>
 #include <QLocale>
 #include <QString>
+#include <QTimer>
+#include <QStandardPaths>
+
+#include "benchmark.h"
+#include "singleinstance.h"
+#include "headless.h"
 
 #include <locale.h>
 
@@ -12,22 +18,76 @@
 
 int main(int argc, char *argv[])
 {
+    Benchmark::Start();
+
+    // --headless has to pick the platform before the QApplication does;
+    //  --benchmark-startup[=N] only drives the runs, it doesn't need a gui of its own
+    for(int i = 1; i < argc; ++i)
+    {
+        QString arg = QString::fromLocal8Bit(argv[i]);
+        if(arg == "--headless")
+            Headless::Prepare();
+        else if(arg == "--benchmark-startup" || arg.startsWith("--benchmark-startup="))
+        {
+            // arguments() isn't argv (qt takes its own options out), so the flag is dropped by value
+            QCoreApplication a(argc, argv);
+            QStringList args;
+            for(auto &flag : QCoreApplication::arguments())
+                if(flag != "--benchmark-startup" && !flag.startsWith("--benchmark-startup="))
+                    args.append(flag);
+            int n = arg.section('=', 1).toInt();
+            return Benchmark::Run(args, n > 0 ? n : 5);
+        }
+    }
+
 #if defined(Q_OS_WIN)
     FreeConsole();
 #endif
     QApplication a(argc, argv);
+
+    // hand the file to the player that's already running, if it's listening;
+    //  we're gone before any window is made
+    if(SingleInstance::Forward(QApplication::arguments()))
+        return 0;
+
     setlocale(LC_NUMERIC, "C"); // for mpv
+    Benchmark::SetActive(QApplication::arguments().contains("--benchmark-startup-run"));
+    // keep benchmark runs, replays and fake mpv runs away from the user's settings, history and session
+    bool testMode = Benchmark::IsActive();
+    for(auto &arg : QApplication::arguments())
+        if(arg.startsWith("--fake-mpv=") || arg.startsWith("--replay="))
+            testMode = true;
+    if(testMode)
+        QStandardPaths::setTestModeEnabled(true);
+    Benchmark::Mark("qapplication");
 
     MainWindow w;
+    Benchmark::Mark("mainwindow");
     w.show();
+    Benchmark::Mark("show");
 
     // parse command line
     QStringList args = QApplication::arguments();
+    bool restore = args.removeAll("--restore-session") > 0;
+    args.removeAll("--benchmark-startup-run");
+    args.removeAll("--single-instance");
+    args.removeAll("--new-instance");
+    args.removeAll("--headless");
+    for(int i = args.length()-1; i > 0; --i)
+        if(args[i].startsWith("--control-socket=") || args[i].startsWith("--script=") ||
+           args[i].startsWith("--fake-mpv=") || args[i].startsWith("--fake-mpv-speed=") ||
+           args[i].startsWith("--record=") || args[i].startsWith("--replay=") ||
+           args[i].startsWith("--replay-speed=") || args[i].startsWith("--replay-baseline="))
+            args.removeAt(i);
     QStringList::iterator arg = args.begin();
     if(++arg != args.end())
-        w.Load(*arg);
+        w.Load(*arg, restore);
     else
-        w.Load();
+    {
+        w.Load(QString(), restore);
+        if(Benchmark::IsActive()) // nothing to play; startup ends when the event loop is idle
+            QTimer::singleShot(0, [] { Benchmark::Mark("idle"); Benchmark::Finish(); });
+    }
 
     return a.exec();
 }
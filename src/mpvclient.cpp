@@ -0,0 +1,79 @@
+#include "mpvclient.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+
+#include "fakempv.h"
+#include "recording.h"
+
+MpvClient *MpvClient::Create()
+{
+    MpvClient *client = nullptr;
+    for(auto &arg : QCoreApplication::arguments())
+        if(arg.startsWith("--fake-mpv=") || arg.startsWith("--replay="))
+            client = new FakeMpv(arg.section('=', 1));
+    if(client == nullptr)
+    {
+        mpv_handle *handle = mpv_create();
+        if(!handle)
+            return nullptr;
+        client = new LibMpvClient(handle);
+    }
+    QString record = Recording::Requested();
+    if(record != QString() && Recording::Start(record))
+        client = new RecordingMpvClient(client);
+    return client;
+}
+
+QVariant MpvClient::ToVariant(const mpv_node &node)
+{
+    switch(node.format)
+    {
+    case MPV_FORMAT_STRING:
+        return QString::fromUtf8(node.u.string);
+    case MPV_FORMAT_FLAG:
+        return bool(node.u.flag);
+    case MPV_FORMAT_INT64:
+        return qint64(node.u.int64);
+    case MPV_FORMAT_DOUBLE:
+        return node.u.double_;
+    case MPV_FORMAT_NODE_ARRAY:
+    {
+        QVariantList list;
+        for(int i = 0; i < node.u.list->num; i++)
+            list.append(ToVariant(node.u.list->values[i]));
+        return list;
+    }
+    case MPV_FORMAT_NODE_MAP:
+    {
+        QVariantMap map;
+        for(int i = 0; i < node.u.list->num; i++)
+            map[QString::fromUtf8(node.u.list->keys[i])] = ToVariant(node.u.list->values[i]);
+        return map;
+    }
+    default: // none, or something we don't know
+        return QVariant();
+    }
+}
+
+QVariant MpvClient::ToVariant(mpv_format format, void *data)
+{
+    if(data == nullptr)
+        return QVariant();
+    switch(format)
+    {
+    case MPV_FORMAT_STRING:
+    case MPV_FORMAT_OSD_STRING:
+        return QString::fromUtf8(*static_cast<char**>(data));
+    case MPV_FORMAT_FLAG:
+        return bool(*static_cast<int*>(data));
+    case MPV_FORMAT_INT64:
+        return qint64(*static_cast<int64_t*>(data));
+    case MPV_FORMAT_DOUBLE:
+        return *static_cast<double*>(data);
+    case MPV_FORMAT_NODE:
+        return ToVariant(*static_cast<mpv_node*>(data));
+    default:
+        return QVariant();
+    }
+}
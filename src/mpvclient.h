@@ -0,0 +1,87 @@
+#ifndef MPVCLIENT_H
+#define MPVCLIENT_H
+
+#include <QVariant>
+
+#include <mpv/client.h>
+
+// the slice of mpv's client api the player's handle uses, so something other than libmpv can stand in for it.
+//  the calls and their semantics are mpv's (see mpv/client.h): same arguments, same error codes, and
+//  WaitEvent()'s event stays valid until the next WaitEvent(). nodes and strings it returns go back
+//  through FreeNodeContents()/Free() of the client that made them.
+class MpvClient
+{
+public:
+    // libmpv, or the fake backend for --fake-mpv=<stream> and --replay=<recording>; recorded
+    //  with --record=<file>. nullptr if mpv couldn't be created
+    static MpvClient *Create();
+
+    // mpv's data as plain variants: maps, lists, strings and numbers
+    static QVariant ToVariant(const mpv_node &node);
+    static QVariant ToVariant(mpv_format format, void *data);
+
+    virtual ~MpvClient() {} // terminates and destroys the handle
+
+    virtual int Initialize() = 0;
+    virtual void SetWakeupCallback(void (*callback)(void *ctx), void *ctx) = 0;
+    virtual mpv_event *WaitEvent(double timeout) = 0;
+    virtual int RequestLogMessages(const char *level) = 0;
+    virtual int64_t GetTimeUs() = 0;
+
+    virtual int SetOption(const char *name, mpv_format format, void *data) = 0;
+    virtual int SetOptionString(const char *name, const char *data) = 0;
+
+    virtual int Command(const char **args) = 0;
+    virtual int CommandAsync(uint64_t userdata, const char **args) = 0;
+    virtual int CommandNode(mpv_node *args, mpv_node *result) = 0;
+    virtual int CommandNodeAsync(uint64_t userdata, mpv_node *args) = 0;
+
+    virtual int GetProperty(const char *name, mpv_format format, void *data) = 0;
+    virtual char *GetPropertyString(const char *name) = 0;
+    virtual int GetPropertyAsync(uint64_t userdata, const char *name, mpv_format format) = 0;
+    virtual int SetPropertyString(const char *name, const char *data) = 0;
+    virtual int SetPropertyAsync(uint64_t userdata, const char *name, mpv_format format, void *data) = 0;
+    virtual int ObserveProperty(uint64_t userdata, const char *name, mpv_format format) = 0;
+    virtual int UnobserveProperty(uint64_t userdata) = 0;
+
+    virtual void FreeNodeContents(mpv_node *node) = 0;
+    virtual void Free(void *data) = 0;
+};
+
+// the real thing
+class LibMpvClient : public MpvClient
+{
+public:
+    explicit LibMpvClient(mpv_handle *handle): handle(handle) {}
+    ~LibMpvClient() { mpv_terminate_destroy(handle); }
+
+    int Initialize()                                    { return mpv_initialize(handle); }
+    void SetWakeupCallback(void (*callback)(void*), void *ctx) { mpv_set_wakeup_callback(handle, callback, ctx); }
+    mpv_event *WaitEvent(double timeout)                { return mpv_wait_event(handle, timeout); }
+    int RequestLogMessages(const char *level)           { return mpv_request_log_messages(handle, level); }
+    int64_t GetTimeUs()                                 { return mpv_get_time_us(handle); }
+
+    int SetOption(const char *name, mpv_format format, void *data) { return mpv_set_option(handle, name, format, data); }
+    int SetOptionString(const char *name, const char *data) { return mpv_set_option_string(handle, name, data); }
+
+    int Command(const char **args)                      { return mpv_command(handle, args); }
+    int CommandAsync(uint64_t userdata, const char **args) { return mpv_command_async(handle, userdata, args); }
+    int CommandNode(mpv_node *args, mpv_node *result)   { return mpv_command_node(handle, args, result); }
+    int CommandNodeAsync(uint64_t userdata, mpv_node *args) { return mpv_command_node_async(handle, userdata, args); }
+
+    int GetProperty(const char *name, mpv_format format, void *data) { return mpv_get_property(handle, name, format, data); }
+    char *GetPropertyString(const char *name)           { return mpv_get_property_string(handle, name); }
+    int GetPropertyAsync(uint64_t userdata, const char *name, mpv_format format) { return mpv_get_property_async(handle, userdata, name, format); }
+    int SetPropertyString(const char *name, const char *data) { return mpv_set_property_string(handle, name, data); }
+    int SetPropertyAsync(uint64_t userdata, const char *name, mpv_format format, void *data) { return mpv_set_property_async(handle, userdata, name, format, data); }
+    int ObserveProperty(uint64_t userdata, const char *name, mpv_format format) { return mpv_observe_property(handle, userdata, name, format); }
+    int UnobserveProperty(uint64_t userdata)            { return mpv_unobserve_property(handle, userdata); }
+
+    void FreeNodeContents(mpv_node *node)               { mpv_free_node_contents(node); }
+    void Free(void *data)                               { mpv_free(data); }
+
+private:
+    mpv_handle *handle;
+};
+
+#endif // MPVCLIENT_H
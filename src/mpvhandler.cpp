@@ -6,10 +6,17 @@
 #include <QFileInfo>
 #include <QFileInfoList>
 #include <QDateTime>
+#include <QVector>
+#include <QThread>
+#include <QTimer>
+
+#include <memory>
 
 #include "bakaengine.h"
 #include "overlayhandler.h"
 #include "util.h"
+#include "tracing.h"
+#include "benchmark.h"
 
 static void wakeup(void *ctx)
 {
@@ -22,58 +29,81 @@ MpvHandler::MpvHandler(int64_t wid, QObject *parent):
     baka(static_cast<BakaEngine*>(parent))
 {
     // create mpv
-    mpv = mpv_create();
+    mpv = MpvClient::Create();
     if(!mpv)
         throw "Could not create mpv object";
 
     // set mpv options
-    mpv_set_option(mpv, "wid", MPV_FORMAT_INT64, &wid);
-    mpv_set_option_string(mpv, "input-cursor", "no");   // no mouse handling
-    mpv_set_option_string(mpv, "cursor-autohide", "no");// no cursor-autohide, we handle that
-    mpv_set_option_string(mpv, "ytdl", "yes"); // youtube-dl support
+    mpv->SetOption("wid", MPV_FORMAT_INT64, &wid);
+    mpv->SetOptionString("input-cursor", "no");   // no mouse handling
+    mpv->SetOptionString("cursor-autohide", "no");// no cursor-autohide, we handle that
+    mpv->SetOptionString("ytdl", "yes"); // youtube-dl support
+    mpv->SetOptionString("demuxer-seekable-cache", "yes"); // seeks into cached ranges don't hit the network
 
     // get updates when these properties change
-    mpv_observe_property(mpv, 0, "playback-time", MPV_FORMAT_DOUBLE);
-    mpv_observe_property(mpv, 0, "ao-volume", MPV_FORMAT_DOUBLE);
-    mpv_observe_property(mpv, 0, "sid", MPV_FORMAT_INT64);
-    mpv_observe_property(mpv, 0, "aid", MPV_FORMAT_INT64);
-    mpv_observe_property(mpv, 0, "sub-visibility", MPV_FORMAT_FLAG);
-    mpv_observe_property(mpv, 0, "ao-mute", MPV_FORMAT_FLAG);
-    mpv_observe_property(mpv, 0, "core-idle", MPV_FORMAT_FLAG);
-    mpv_observe_property(mpv, 0, "paused-for-cache", MPV_FORMAT_FLAG);
+    mpv->ObserveProperty(0, "playback-time", MPV_FORMAT_DOUBLE);
+    mpv->ObserveProperty(0, "ao-volume", MPV_FORMAT_DOUBLE);
+    mpv->ObserveProperty(0, "sid", MPV_FORMAT_INT64);
+    mpv->ObserveProperty(0, "aid", MPV_FORMAT_INT64);
+    mpv->ObserveProperty(0, "sub-visibility", MPV_FORMAT_FLAG);
+    mpv->ObserveProperty(0, "ao-mute", MPV_FORMAT_FLAG);
+    mpv->ObserveProperty(0, "core-idle", MPV_FORMAT_FLAG);
+    mpv->ObserveProperty(0, "paused-for-cache", MPV_FORMAT_FLAG);
+    mpv->ObserveProperty(0, "demuxer-cache-state", MPV_FORMAT_NODE);
 
     // setup callback event handling
-    mpv_set_wakeup_callback(mpv, wakeup, this);
+    mpv->SetWakeupCallback(wakeup, this);
 }
 
 MpvHandler::~MpvHandler()
 {
+    if(initializing.valid())
+        initializing.wait();
     if(mpv)
     {
-        mpv_terminate_destroy(mpv);
+        delete mpv;
         mpv = NULL;
     }
 }
 
 void MpvHandler::Initialize()
 {
-    if(mpv_initialize(mpv) < 0)
-        throw "Could not initialize mpv";
+    // mpv_initialize reads the config and loads scripts and drivers before it returns;
+    //  none of that needs the gui thread, and the client api is safe to use from both meanwhile
+    initializing = std::async(std::launch::async,
+                              [=]
+                              {
+                                  BAKA_TRACE("mpv_initialize");
+                                  bool ok = mpv->Initialize() >= 0;
+                                  running = ok;
+                                  emit initialized(ok);
+                              });
 }
 
-QString MpvHandler::getMediaInfo()
+void MpvHandler::MediaInfo(std::function<void(QString)> then)
 {
-    QFileInfo fi(path+file);
+    quint64 was = loaded;
+    GetPropertiesAsync({"avsync", "estimated-vf-fps", "video-bitrate", "audio-bitrate",
+                        "current-vo", "current-ao", "hwdec-active"},
+                       [=](const QVariantMap &values)
+                       {
+                           if(was != loaded) // another file by now
+                               return;
+                           then(MediaInfoText(values));
+                       });
+}
 
-    double avsync, fps, vbitrate, abitrate;
+QString MpvHandler::MediaInfoText(const QVariantMap &values)
+{
+    QFileInfo fi(path+file);
 
-    mpv_get_property(mpv, "avsync", MPV_FORMAT_DOUBLE, &avsync);
-    mpv_get_property(mpv, "estimated-vf-fps", MPV_FORMAT_DOUBLE, &fps);
-    mpv_get_property(mpv, "video-bitrate", MPV_FORMAT_DOUBLE, &vbitrate);
-    mpv_get_property(mpv, "audio-bitrate", MPV_FORMAT_DOUBLE, &abitrate);
-    QString current_vo = mpv_get_property_string(mpv, "current-vo"),
-            current_ao = mpv_get_property_string(mpv, "current-ao"),
-            hwdec_active = mpv_get_property_string(mpv, "hwdec-active");
+    double avsync = values["avsync"].toDouble(),
+           fps = values["estimated-vf-fps"].toDouble(),
+           vbitrate = values["video-bitrate"].toDouble(),
+           abitrate = values["audio-bitrate"].toDouble();
+    QString current_vo = values["current-vo"].toString(),
+            current_ao = values["current-ao"].toString(),
+            hwdec_active = values["hwdec-active"].toString();
 
     int vtracks = 0,
         atracks = 0;
@@ -109,6 +139,12 @@ QString MpvHandler::getMediaInfo()
             inner.arg(tr("Channels"), QString::number(fileInfo.audio_params.channels)) +
             inner.arg(tr("Bitrate"), tr("%0 kbps").arg(abitrate)) + '\n';
 
+    if(path == QString() && cacheState.totalBytes > 0) // streams
+        out += outer.arg(tr("Cache"), tr("%0 sec").arg(QString::number(cacheState.duration, 'f', 1))) +
+            inner.arg(tr("Forward"), Util::HumanSize(cacheState.fwBytes)) +
+            inner.arg(tr("Total"), Util::HumanSize(cacheState.totalBytes)) +
+            inner.arg(tr("Fill Rate"), tr("%0/s").arg(Util::HumanSize(cacheState.inputRate))) + '\n';
+
     if(fileInfo.chapters.length() > 0)
     {
         out += outer.arg(tr("Chapters"), QString());
@@ -133,21 +169,28 @@ bool MpvHandler::event(QEvent *event)
 {
     if(event->type() == QEvent::User)
     {
+        BAKA_TRACE("MpvHandler::event");
         while(mpv)
         {
-            mpv_event *event = mpv_wait_event(mpv, 0);
+            mpv_event *event = mpv->WaitEvent(0);
             if(event == nullptr ||
                event->event_id == MPV_EVENT_NONE)
             {
                 break;
             }
-            HandleErrorCode(event->error);
+            if(event->reply_userdata < MPV_REPLY_REQUEST) // requests have their own continuation for errors
+                HandleErrorCode(event->error);
             switch (event->event_id)
             {
             case MPV_EVENT_PROPERTY_CHANGE:
             {
                 mpv_event_property *prop = (mpv_event_property*)event->data;
-                if(QString(prop->name) == "playback-time") // playback-time does the same thing as time-pos but works for streaming media
+                if(event->reply_userdata >= MPV_REPLY_OBSERVE)
+                {
+                    emit observedPropertyChanged(QString::fromUtf8(prop->name),
+                                                 prop->format == MPV_FORMAT_NODE ? MpvClient::ToVariant(*(mpv_node*)prop->data) : QVariant());
+                }
+                else if(QString(prop->name) == "playback-time") // playback-time does the same thing as time-pos but works for streaming media
                 {
                     if(prop->format == MPV_FORMAT_DOUBLE)
                     {
@@ -184,7 +227,8 @@ bool MpvHandler::event(QEvent *event)
                 {
                     if(prop->format == MPV_FORMAT_FLAG)
                     {
-                        if((bool)*(unsigned*)prop->data && playState == Mpv::Playing)
+                        // seeks into cached ranges are served from memory; don't claim we're waiting on anything
+                        if((bool)*(unsigned*)prop->data && playState == Mpv::Playing && !cachedSeek)
                             ShowText(tr("Buffering..."), 0);
                         else
                             ShowText(QString(), 0);
@@ -194,12 +238,19 @@ bool MpvHandler::event(QEvent *event)
                 {
                     if(prop->format == MPV_FORMAT_FLAG)
                     {
-                        if((bool)*(unsigned*)prop->data && playState == Mpv::Playing)
+                        if((bool)*(unsigned*)prop->data && playState == Mpv::Playing && !cachedSeek)
                             ShowText(tr("Your network is slow or stuck, please wait a bit"), 0);
                         else
                             ShowText(QString(), 0);
                     }
                 }
+                else if(QString(prop->name) == "demuxer-cache-state")
+                {
+                    if(prop->format == MPV_FORMAT_NODE)
+                        LoadCacheState(*(mpv_node*)prop->data);
+                    else // no file or no cache
+                        setCacheState(Mpv::CacheState());
+                }
                 break;
             }
             case MPV_EVENT_IDLE:
@@ -209,6 +260,7 @@ bool MpvHandler::event(QEvent *event)
                 break;
                 // these two look like they're reversed but they aren't. the names are misleading.
             case MPV_EVENT_START_FILE:
+                ++loaded;
                 setPlayState(Mpv::Loaded);
                 break;
             case MPV_EVENT_FILE_LOADED:
@@ -218,13 +270,21 @@ bool MpvHandler::event(QEvent *event)
             case MPV_EVENT_UNPAUSE:
                 setPlayState(Mpv::Playing);
                 break;
+            case MPV_EVENT_PLAYBACK_RESTART:
+                cachedSeek = false;
+                Benchmark::Mark("first-frame");
+                Benchmark::Finish();
+                emit playbackRestarted();
+                break;
             case MPV_EVENT_PAUSE:
                 setPlayState(Mpv::Paused);
                 ShowText(QString(), 0);
                 break;
             case MPV_EVENT_END_FILE:
+                ++loaded;
                 if(playState == Mpv::Loaded)
                     ShowText(tr("File couldn't be opened"));
+                Benchmark::Finish(); // never got to a frame
                 setPlayState(Mpv::Stopped);
                 break;
             case MPV_EVENT_SHUTDOWN:
@@ -233,8 +293,32 @@ bool MpvHandler::event(QEvent *event)
             case MPV_EVENT_LOG_MESSAGE:
             {
                 mpv_event_log_message *message = static_cast<mpv_event_log_message*>(event->data);
+                // suppressed modules are dropped here, before any conversion
+                if(message != nullptr && LogEnabled(message->prefix, message->log_level))
+                {
+                    Mpv::LogMessage m;
+                    m.time = mpv->GetTimeUs();
+                    m.level = message->log_level;
+                    m.prefix = QString::fromUtf8(message->prefix);
+                    m.text = QString::fromUtf8(message->text);
+                    emit logMessage(m);
+                }
+                break;
+            }
+            case MPV_EVENT_COMMAND_REPLY:
+            case MPV_EVENT_GET_PROPERTY_REPLY:
+                Answer(event);
+                break;
+            case MPV_EVENT_CLIENT_MESSAGE:
+            {
+                mpv_event_client_message *message = static_cast<mpv_event_client_message*>(event->data);
                 if(message != nullptr)
-                    emit messageSignal(message->text);
+                {
+                    QStringList args;
+                    for(int i = 0; i < message->num_args; ++i)
+                        args.append(QString::fromUtf8(message->args[i]));
+                    emit clientMessage(args);
+                }
                 break;
             }
             default: // unhandled events
@@ -246,29 +330,20 @@ bool MpvHandler::event(QEvent *event)
     return QObject::event(event);
 }
 
-void MpvHandler::AddOverlay(int id, int x, int y, QString file, int offset, int w, int h)
+void MpvHandler::AddOverlay(int id, int x, int y, QString file, int offset, int w, int h, Reply then)
 {
-    QByteArray tmp_id = QString::number(id).toUtf8(),
-               tmp_x = QString::number(x).toUtf8(),
-               tmp_y = QString::number(y).toUtf8(),
-               tmp_file = file.toUtf8(),
-               tmp_offset = QString::number(offset).toUtf8(),
-               tmp_w = QString::number(w).toUtf8(),
-               tmp_h = QString::number(h).toUtf8(),
-               tmp_stride = QString::number(4*w).toUtf8();
-
-    const char *args[] = {"overlay_add",
-                       tmp_id.constData(),
-                       tmp_x.constData(),
-                       tmp_y.constData(),
-                       tmp_file.constData(),
-                       tmp_offset.constData(),
-                       "bgra",
-                       tmp_w.constData(),
-                       tmp_h.constData(),
-                       tmp_stride.constData(),
-                       NULL};
-    Command(args);
+    BAKA_TRACE("MpvHandler::AddOverlay");
+    CommandAsync({"overlay_add",
+                  QString::number(id),
+                  QString::number(x),
+                  QString::number(y),
+                  file,
+                  QString::number(offset),
+                  "bgra",
+                  QString::number(w),
+                  QString::number(h),
+                  QString::number(4*w)},
+                 then);
 }
 
 void MpvHandler::RemoveOverlay(int id)
@@ -278,6 +353,30 @@ void MpvHandler::RemoveOverlay(int id)
     AsyncCommand(args);
 }
 
+void MpvHandler::OsdOverlay(int id, QString ass, int w, int h)
+{
+    QByteArray tmp_id = QString::number(id).toUtf8(),
+               tmp_data = ass.toUtf8(),
+               tmp_w = QString::number(w).toUtf8(),
+               tmp_h = QString::number(h).toUtf8();
+
+    const char *args[] = {"osd-overlay",
+                          tmp_id.constData(),
+                          "ass-events",
+                          tmp_data.constData(),
+                          tmp_w.constData(),
+                          tmp_h.constData(),
+                          NULL};
+    AsyncCommand(args);
+}
+
+void MpvHandler::RemoveOsdOverlay(int id)
+{
+    QByteArray tmp = QString::number(id).toUtf8();
+    const char *args[] = {"osd-overlay", tmp.constData(), "none", "", NULL};
+    AsyncCommand(args);
+}
+
 bool MpvHandler::FileExists(QString f)
 {
     if(Util::IsValidUrl(f)) // web url
@@ -356,12 +455,32 @@ bool MpvHandler::PlayFile(QString f)
     return true;
 }
 
+void MpvHandler::Restore(QString p, const QStringList &list, QString f, int t, int v, int a, int s)
+{
+    // the playlist comes from the session as it was (shuffled or not); no directory scan
+    setPath(p);
+    setPlaylist(list);
+    // position and tracks go with the loadfile so there's no seek or track switch afterwards
+    QStringList options;
+    if(t > 0)
+        options << QString("start=%0").arg(QString::number(t));
+    if(v > 0)
+        options << QString("vid=%0").arg(QString::number(v));
+    if(a > 0)
+        options << QString("aid=%0").arg(QString::number(a));
+    if(s > 0)
+        options << QString("sid=%0").arg(QString::number(s));
+    OpenFile(p+f, options.join(','));
+    setFile(f);
+    Play();
+}
+
 void MpvHandler::Play()
 {
     if(playState > 0 && mpv)
     {
         int f = 0;
-        mpv_set_property_async(mpv, MPV_REPLY_PROPERTY, "pause", MPV_FORMAT_FLAG, &f);
+        mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, "pause", MPV_FORMAT_FLAG, &f);
     }
 }
 
@@ -370,7 +489,7 @@ void MpvHandler::Pause()
     if(playState > 0 && mpv)
     {
         int f = 1;
-        mpv_set_property_async(mpv, MPV_REPLY_PROPERTY, "pause", MPV_FORMAT_FLAG, &f);
+        mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, "pause", MPV_FORMAT_FLAG, &f);
     }
 }
 
@@ -428,6 +547,7 @@ void MpvHandler::Seek(int pos, bool relative, bool osd)
 {
     if(playState > 0)
     {
+        cachedSeek = IsCached(relative ? time+pos : pos);
         if(relative)
         {
             const QByteArray tmp = (((pos >= 0) ? "+" : QString())+QString::number(pos)).toUtf8();
@@ -480,7 +600,7 @@ void MpvHandler::FrameBackStep()
 
 void MpvHandler::Chapter(int c)
 {
-    mpv_set_property_async(mpv, MPV_REPLY_PROPERTY, "chapter", MPV_FORMAT_INT64, &c);
+    mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, "chapter", MPV_FORMAT_INT64, &c);
 //    const QByteArray tmp = QString::number(c).toUtf8();
 //    const char *args[] = {"set", "chapter", tmp.constData(), NULL};
 //    AsyncCommand(args);
@@ -507,13 +627,16 @@ void MpvHandler::Volume(int level, bool osd)
 
     if(playState > 0)
     {
-        mpv_set_property_async(mpv, MPV_REPLY_PROPERTY, "ao-volume", MPV_FORMAT_DOUBLE, &v);
+        mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, "ao-volume", MPV_FORMAT_DOUBLE, &v);
         if(osd)
             ShowText(tr("Volume: %0%").arg(QString::number(level)));
     }
     else
     {
-        mpv_set_option(mpv, "volume", MPV_FORMAT_DOUBLE, &v);
+        if(running)
+            mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, "volume", MPV_FORMAT_DOUBLE, &v);
+        else
+            mpv->SetOption("volume", MPV_FORMAT_DOUBLE, &v);
         setVolume(level);
     }
 }
@@ -521,7 +644,7 @@ void MpvHandler::Volume(int level, bool osd)
 void MpvHandler::Speed(double d)
 {
     if(playState > 0)
-        mpv_set_property_async(mpv, MPV_REPLY_PROPERTY, "speed", MPV_FORMAT_DOUBLE, &d);
+        mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, "speed", MPV_FORMAT_DOUBLE, &d);
     setSpeed(d);
 }
 
@@ -580,35 +703,48 @@ void MpvHandler::ScreenshotDirectory(QString s)
 
 void MpvHandler::AddSubtitleTrack(QString f)
 {
-    if(f == QString())
-        return;
-    const QByteArray tmp = f.toUtf8();
-    const char *args[] = {"sub-add", tmp.constData(), NULL};
-    Command(args);
-    // this could be more efficient if we saved tracks in a bst
-    auto old = fileInfo.tracks; // save the current track-list
-    LoadTracks(); // load the new track list
-    auto current = fileInfo.tracks;
-    for(auto track : old) // remove the old tracks in current
-        current.removeOne(track);
-    Mpv::Track &track = current.first();
-    ShowText(QString("%0: %1 (%2)").arg(QString::number(track.id), track.title, track.external ? "external" : track.lang));
+    BAKA_TRACE("MpvHandler::AddSubtitleTrack");
+    AddTrack("sub-add", f);
 }
 
 void MpvHandler::AddAudioTrack(QString f)
+{
+    BAKA_TRACE("MpvHandler::AddAudioTrack");
+    AddTrack("audio-add", f);
+}
+
+void MpvHandler::AddTrack(QString command, QString f)
 {
     if(f == QString())
         return;
-    const QByteArray tmp = f.toUtf8();
-    const char *args[] = {"audio-add", tmp.constData(), NULL};
-    Command(args);
-    auto old = fileInfo.tracks;
-    LoadTracks();
-    auto current = fileInfo.tracks;
-    for(auto track : old)
-        current.removeOne(track);
-    Mpv::Track &track = current.first();
-    ShowText(QString("%0: %1 (%2)").arg(QString::number(track.id), track.title, track.external ? "external" : track.lang));
+    quint64 was = loaded;
+    CommandAsync({command, f},
+                 [=](int error, const QVariant&)
+                 {
+                     if(was != loaded) // another file by now
+                         return;
+                     if(error < 0)
+                     {
+                         HandleErrorCode(error);
+                         return;
+                     }
+                     GetPropertyAsync("track-list",
+                                      [=](int error, const QVariant &list)
+                                      {
+                                          if(error < 0 || was != loaded)
+                                              return;
+                                          // this could be more efficient if we saved tracks in a bst
+                                          auto old = fileInfo.tracks; // save the current track-list
+                                          SetTracks(list); // load the new track list
+                                          auto current = fileInfo.tracks;
+                                          for(auto track : old) // remove the old tracks in current
+                                              current.removeOne(track);
+                                          if(current.isEmpty())
+                                              return;
+                                          Mpv::Track &track = current.first();
+                                          ShowText(QString("%0: %1 (%2)").arg(QString::number(track.id), track.title, track.external ? "external" : track.lang));
+                                      });
+                 });
 }
 
 void MpvHandler::ShowSubtitles(bool b)
@@ -626,14 +762,28 @@ void MpvHandler::SubtitleScale(double scale, bool relative)
 
 void MpvHandler::Deinterlace(bool deinterlace)
 {
-    HandleErrorCode(mpv_set_property_string(mpv, "deinterlace", deinterlace ? "yes" : "auto"));
+    BAKA_TRACE("MpvHandler::Deinterlace");
+    CommandAsync({"set", "deinterlace", deinterlace ? "yes" : "auto"});
     ShowText(tr("Deinterlacing: %0").arg(deinterlace ? tr("enabled") : tr("disabled")));
 }
 
 void MpvHandler::Interpolate(bool interpolate)
 {
     if(vo == QString())
-        vo = mpv_get_property_string(mpv, "current-vo");
+    {
+        // nothing set; start from what mpv picked
+        quint64 was = loaded;
+        GetPropertyAsync("current-vo",
+                         [=](int error, const QVariant &picked)
+                         {
+                             if(error >= 0 && was == loaded && picked.toString() != QString())
+                             {
+                                 vo = picked.toString();
+                                 Interpolate(interpolate);
+                             }
+                         });
+        return;
+    }
     QStringList vos = vo.split(',');
     for(auto &o : vos)
     {
@@ -656,199 +806,246 @@ void MpvHandler::Vo(QString o)
 
 void MpvHandler::MsgLevel(QString level)
 {
-    QByteArray tmp = level.toUtf8();
-    mpv_request_log_messages(mpv, tmp.constData());
+    // ordered by verbosity; "status" has no client api level of its own and arrives as info
+    static const QList<QPair<QString, int>> levels = {
+        {"no", MPV_LOG_LEVEL_NONE},
+        {"fatal", MPV_LOG_LEVEL_FATAL},
+        {"error", MPV_LOG_LEVEL_ERROR},
+        {"warn", MPV_LOG_LEVEL_WARN},
+        {"info", MPV_LOG_LEVEL_INFO},
+        {"status", MPV_LOG_LEVEL_INFO},
+        {"v", MPV_LOG_LEVEL_V},
+        {"debug", MPV_LOG_LEVEL_DEBUG},
+        {"trace", MPV_LOG_LEVEL_TRACE}
+    };
+    auto find = [=](QString name)
+    {
+        for(int i = 0; i < levels.length(); ++i)
+            if(levels[i].first == name)
+                return i;
+        return -1;
+    };
+
+    QList<LogRule> rules;
+    int all = find("status"),
+        request = 0; // most verbose level any rule wants; mpv doesn't send us anything past it
+    for(auto &rule : level.split(',', QString::SkipEmptyParts))
+    {
+        QString prefix = rule.section('=', 0, 0).trimmed(),
+                name = rule.section('=', 1).trimmed();
+        if(!rule.contains('=')) // a bare level applies to everything
+        {
+            name = prefix;
+            prefix = "all";
+        }
+        int i = find(name);
+        if(prefix == QString() || i == -1)
+        {
+            emit messageSignal(tr("invalid msg-level rule '%0'").arg(rule)+"\n");
+            return;
+        }
+        if(prefix == "all")
+            all = i;
+        else
+        {
+            for(auto r = rules.begin(); r != rules.end(); ++r) // later rules win
+            {
+                if(r->prefix == prefix.toUtf8())
+                {
+                    rules.erase(r);
+                    break;
+                }
+            }
+            rules.append({prefix.toUtf8(), levels[i].second});
+        }
+        request = qMax(request, i);
+    }
+    request = qMax(request, all);
+
+    logRules = rules;
+    logLevel = levels[all].second;
+    QByteArray tmp = levels[request].first.toUtf8();
+    mpv->RequestLogMessages(tmp.constData());
     setMsgLevel(level);
 }
 
+bool MpvHandler::LogEnabled(const char *prefix, int level)
+{
+    // like mpv, a rule covers its module and the modules under it ("vo" is "vo/gpu/opengl" too),
+    //  and of the rules that match, the last one wins
+    for(int i = logRules.length()-1; i >= 0; --i)
+    {
+        const QByteArray &rule = logRules[i].prefix;
+        if(qstrncmp(rule.constData(), prefix, uint(rule.size())) == 0 &&
+           (prefix[rule.size()] == '\0' || prefix[rule.size()] == '/'))
+            return level <= logRules[i].level;
+    }
+    return level <= logLevel;
+}
+
 void MpvHandler::ShowText(QString text, int duration)
 {
+    // the overlay handler decides whether mpv (osd-overlay) or qt renders the text
     baka->overlay->showStatusText(text, duration);
-    /*
-    const QByteArray tmp1 = text.toUtf8(),
-                     tmp2 = QString::number(duration).toUtf8(),
-                     tmp3 = QString::number(level).toUtf8();
-    const char *args[] = {"show_text", tmp1.constData(), tmp2.constData(), tmp3.constData(), NULL};
-    AsyncCommand(args);
-    */
 }
 
 void MpvHandler::LoadFileInfo()
 {
-    // get media-title
-    fileInfo.media_title = mpv_get_property_string(mpv, "media-title");
-    // get length
-    double len;
-    mpv_get_property(mpv, "length", MPV_FORMAT_DOUBLE, &len);
-    fileInfo.length                  = (int)len;
+    BAKA_TRACE("MpvHandler::LoadFileInfo");
+    // all of it in one go; the file plays on while mpv gathers it
+    quint64 was = loaded;
+    GetPropertiesAsync({"media-title", "length", "track-list", "chapter-list",
+                        "video-codec", "width", "height", "dwidth", "dheight",
+                        "audio-codec", "audio-params", "metadata"},
+                       [=](const QVariantMap &values)
+                       {
+                           if(was != loaded) // another file by now
+                               return;
+                           fileInfo.media_title = values["media-title"].toString();
+                           fileInfo.length = (int)values["length"].toDouble();
+                           SetTracks(values["track-list"]);
+                           SetChapters(values["chapter-list"]);
+                           SetVideoParams(values);
+                           SetAudioParams(values);
+                           SetMetadata(values["metadata"]);
+
+                           emit fileInfoChanged(fileInfo);
+                       });
+}
+
+void MpvHandler::LoadTracks()
+{
+    GetPropertyAsync("track-list",
+                     [=](int error, const QVariant &list)
+                     {
+                         if(error >= 0)
+                             SetTracks(list);
+                     });
+}
 
-    LoadTracks();
-    LoadChapters();
-    LoadVideoParams();
-    LoadAudioParams();
-    LoadMetadata();
+void MpvHandler::LoadChapters()
+{
+    GetPropertyAsync("chapter-list",
+                     [=](int error, const QVariant &list)
+                     {
+                         if(error >= 0)
+                             SetChapters(list);
+                     });
+}
 
-    emit fileInfoChanged(fileInfo);
+void MpvHandler::LoadVideoParams()
+{
+    LoadVideoParams([]{});
 }
 
-void MpvHandler::LoadTracks()
+void MpvHandler::LoadVideoParams(std::function<void()> then)
+{
+    GetPropertiesAsync({"video-codec", "width", "height", "dwidth", "dheight"},
+                       [=](const QVariantMap &values)
+                       {
+                           SetVideoParams(values);
+                           then();
+                       });
+}
+
+void MpvHandler::LoadAudioParams()
+{
+    GetPropertiesAsync({"audio-codec", "audio-params"},
+                       [=](const QVariantMap &values)
+                       {
+                           SetAudioParams(values);
+                       });
+}
+
+void MpvHandler::LoadMetadata()
+{
+    GetPropertyAsync("metadata",
+                     [=](int error, const QVariant &map)
+                     {
+                         if(error >= 0)
+                             SetMetadata(map);
+                     });
+}
+
+void MpvHandler::LoadOsdSize()
+{
+    GetPropertiesAsync({"osd-width", "osd-height"},
+                       [=](const QVariantMap &values)
+                       {
+                           osdWidth = values["osd-width"].toInt();
+                           osdHeight = values["osd-height"].toInt();
+                       });
+}
+
+void MpvHandler::SetTracks(const QVariant &list)
 {
     fileInfo.tracks.clear();
-    mpv_node node;
-    mpv_get_property(mpv, "track-list", MPV_FORMAT_NODE, &node);
-    if(node.format == MPV_FORMAT_NODE_ARRAY)
+    for(auto &value : list.toList())
     {
-        for(int i = 0; i < node.u.list->num; i++)
-        {
-            if(node.u.list->values[i].format == MPV_FORMAT_NODE_MAP)
-            {
-                Mpv::Track track;
-                for(int n = 0; n < node.u.list->values[i].u.list->num; n++)
-                {
-                    if(QString(node.u.list->values[i].u.list->keys[n]) == "id")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_INT64)
-                            track.id = node.u.list->values[i].u.list->values[n].u.int64;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "type")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_STRING)
-                            track.type = node.u.list->values[i].u.list->values[n].u.string;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "src-id")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_INT64)
-                            track.src_id = node.u.list->values[i].u.list->values[n].u.int64;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "title")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_STRING)
-                            track.title = node.u.list->values[i].u.list->values[n].u.string;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "lang")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_STRING)
-                            track.lang = node.u.list->values[i].u.list->values[n].u.string;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "albumart")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_FLAG)
-                            track.albumart = node.u.list->values[i].u.list->values[n].u.flag;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "default")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_FLAG)
-                            track._default = node.u.list->values[i].u.list->values[n].u.flag;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "external")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_FLAG)
-                            track.external = node.u.list->values[i].u.list->values[n].u.flag;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "external-filename")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_STRING)
-                            track.external_filename = node.u.list->values[i].u.list->values[n].u.string;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "codec")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_STRING)
-                            track.codec = node.u.list->values[i].u.list->values[n].u.string;
-                    }
-                }
-                fileInfo.tracks.push_back(track);
-            }
-        }
+        if(value.type() != QVariant::Map)
+            continue;
+        QVariantMap map = value.toMap();
+        Mpv::Track track;
+        track.id = map["id"].toInt();
+        track.type = map["type"].toString();
+        track.src_id = map["src-id"].toInt();
+        track.title = map["title"].toString();
+        track.lang = map["lang"].toString();
+        track.albumart = map["albumart"].toBool();
+        track._default = map["default"].toBool();
+        track.external = map["external"].toBool();
+        track.external_filename = map["external-filename"].toString();
+        track.codec = map["codec"].toString();
+        fileInfo.tracks.push_back(track);
     }
 
     emit trackListChanged(fileInfo.tracks);
 }
 
-void MpvHandler::LoadChapters()
+void MpvHandler::SetChapters(const QVariant &list)
 {
     fileInfo.chapters.clear();
-    mpv_node node;
-    mpv_get_property(mpv, "chapter-list", MPV_FORMAT_NODE, &node);
-    if(node.format == MPV_FORMAT_NODE_ARRAY)
+    for(auto &value : list.toList())
     {
-        for(int i = 0; i < node.u.list->num; i++)
-        {
-            if(node.u.list->values[i].format == MPV_FORMAT_NODE_MAP)
-            {
-                Mpv::Chapter ch;
-                for(int n = 0; n < node.u.list->values[i].u.list->num; n++)
-                {
-                    if(QString(node.u.list->values[i].u.list->keys[n]) == "title")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_STRING)
-                            ch.title = node.u.list->values[i].u.list->values[n].u.string;
-                    }
-                    else if(QString(node.u.list->values[i].u.list->keys[n]) == "time")
-                    {
-                        if(node.u.list->values[i].u.list->values[n].format == MPV_FORMAT_DOUBLE)
-                            ch.time = (int)node.u.list->values[i].u.list->values[n].u.double_;
-                    }
-                }
-                fileInfo.chapters.push_back(ch);
-            }
-        }
+        if(value.type() != QVariant::Map)
+            continue;
+        QVariantMap map = value.toMap();
+        Mpv::Chapter ch;
+        ch.title = map["title"].toString();
+        ch.time = (int)map["time"].toDouble();
+        fileInfo.chapters.push_back(ch);
     }
     emit chaptersChanged(fileInfo.chapters);
 }
 
-void MpvHandler::LoadVideoParams()
+void MpvHandler::SetVideoParams(const QVariantMap &values)
 {
-    fileInfo.video_params.codec = mpv_get_property_string(mpv, "video-codec");
-    mpv_get_property(mpv, "width",        MPV_FORMAT_INT64, &fileInfo.video_params.width);
-    mpv_get_property(mpv, "height",       MPV_FORMAT_INT64, &fileInfo.video_params.height);
-    mpv_get_property(mpv, "dwidth",       MPV_FORMAT_INT64, &fileInfo.video_params.dwidth);
-    mpv_get_property(mpv, "dheight",      MPV_FORMAT_INT64, &fileInfo.video_params.dheight);
-    // though this has become useless, removing it causes a segfault--no clue:
-    mpv_get_property(mpv, "video-aspect", MPV_FORMAT_INT64, &fileInfo.video_params.aspect);
+    fileInfo.video_params.codec = values["video-codec"].toString();
+    fileInfo.video_params.width = values["width"].toInt();
+    fileInfo.video_params.height = values["height"].toInt();
+    fileInfo.video_params.dwidth = values["dwidth"].toInt();
+    fileInfo.video_params.dheight = values["dheight"].toInt();
 
     emit videoParamsChanged(fileInfo.video_params);
 }
 
-void MpvHandler::LoadAudioParams()
+void MpvHandler::SetAudioParams(const QVariantMap &values)
 {
-    fileInfo.audio_params.codec = mpv_get_property_string(mpv, "audio-codec");
-    mpv_node node;
-    mpv_get_property(mpv, "audio-params", MPV_FORMAT_NODE, &node);
-    if(node.format == MPV_FORMAT_NODE_MAP)
-    {
-        for(int i = 0; i < node.u.list->num; i++)
-        {
-            if(QString(node.u.list->keys[i]) == "samplerate")
-            {
-                if(node.u.list->values[i].format == MPV_FORMAT_INT64)
-                    fileInfo.audio_params.samplerate = node.u.list->values[i].u.int64;
-            }
-            else if(QString(node.u.list->keys[i]) == "channel-count")
-            {
-                if(node.u.list->values[i].format == MPV_FORMAT_INT64)
-                    fileInfo.audio_params.channels = node.u.list->values[i].u.int64;
-            }
-        }
-    }
+    fileInfo.audio_params.codec = values["audio-codec"].toString();
+    QVariantMap params = values["audio-params"].toMap();
+    fileInfo.audio_params.samplerate = params["samplerate"].toInt();
+    fileInfo.audio_params.channels = params["channel-count"].toInt();
 
     emit audioParamsChanged(fileInfo.audio_params);
 }
 
-void MpvHandler::LoadMetadata()
+void MpvHandler::SetMetadata(const QVariant &map)
 {
     fileInfo.metadata.clear();
-    mpv_node node;
-    mpv_get_property(mpv, "metadata", MPV_FORMAT_NODE, &node);
-    if(node.format == MPV_FORMAT_NODE_MAP)
-        for(int n = 0; n < node.u.list->num; n++)
-            if(node.u.list->values[n].format == MPV_FORMAT_STRING)
-                fileInfo.metadata[node.u.list->keys[n]] = node.u.list->values[n].u.string;
-}
-
-void MpvHandler::LoadOsdSize()
-{
-    mpv_get_property(mpv, "osd-width", MPV_FORMAT_INT64, &osdWidth);
-    mpv_get_property(mpv, "osd-height", MPV_FORMAT_INT64, &osdHeight);
+    QVariantMap values = map.toMap();
+    for(auto value = values.begin(); value != values.end(); ++value)
+        if(value->type() == QVariant::String)
+            fileInfo.metadata[value.key()] = value->toString();
 }
 
 void MpvHandler::Command(const QStringList &strlist)
@@ -871,24 +1068,214 @@ void MpvHandler::Command(const QStringList &strlist)
 //    mpv_command_string(mpv, tmp.constData());
 }
 
+// a command's arguments as mpv's node array. the node points into strings, values and list;
+//  they have to stay put while mpv looks at it
+static mpv_node CommandArgs(const QStringList &args, QList<QByteArray> &strings, QVector<mpv_node> &values, mpv_node_list &list)
+{
+    for(auto &arg : args)
+        strings.append(arg.toUtf8());
+    values.resize(strings.length());
+    for(int i = 0; i < strings.length(); ++i)
+    {
+        values[i].format = MPV_FORMAT_STRING;
+        values[i].u.string = strings[i].data();
+    }
+    list.num = values.length();
+    list.values = values.data();
+    list.keys = nullptr;
+    mpv_node node;
+    node.format = MPV_FORMAT_NODE_ARRAY;
+    node.u.list = &list;
+    return node;
+}
+
+// blocking calls wait on mpv's core, which can be busy for seconds; the gui thread uses the async api
+#define ASSERT_NOT_GUI_THREAD() \
+    Q_ASSERT_X(!running || QThread::currentThread() != qApp->thread(), Q_FUNC_INFO, "blocking mpv call on the gui thread")
+
+int MpvHandler::CommandNode(const QStringList &args, QVariant &result)
+{
+    ASSERT_NOT_GUI_THREAD();
+    QList<QByteArray> strings;
+    QVector<mpv_node> values;
+    mpv_node_list list;
+    mpv_node node = CommandArgs(args, strings, values, list), ret;
+    int error = mpv->CommandNode(&node, &ret);
+    if(error >= 0)
+    {
+        result = MpvClient::ToVariant(ret);
+        mpv->FreeNodeContents(&ret);
+    }
+    return error;
+}
+
+int MpvHandler::GetProperty(QString name, QVariant &value)
+{
+    ASSERT_NOT_GUI_THREAD();
+    BAKA_TRACE("mpv_get_property");
+    const QByteArray tmp = name.toUtf8();
+    mpv_node node;
+    int error = mpv->GetProperty(tmp.constData(), MPV_FORMAT_NODE, &node);
+    if(error >= 0)
+    {
+        value = MpvClient::ToVariant(node);
+        mpv->FreeNodeContents(&node);
+    }
+    return error;
+}
+
+void MpvHandler::CommandAsync(const QStringList &args, Reply then)
+{
+    QList<QByteArray> strings;
+    QVector<mpv_node> values;
+    mpv_node_list list;
+    mpv_node node = CommandArgs(args, strings, values, list); // mpv copies it
+    quint64 userdata = Request(MPV_EVENT_COMMAND_REPLY, QString(), then);
+    int error = mpv->CommandNodeAsync(userdata ? userdata : MPV_REPLY_COMMAND, &node);
+    if(error < 0)
+        Fail(userdata, error);
+}
+
+void MpvHandler::GetPropertyAsync(QString name, Reply then)
+{
+    const QByteArray tmp = name.toUtf8();
+    quint64 userdata = Request(MPV_EVENT_GET_PROPERTY_REPLY, name, then);
+    int error = mpv->GetPropertyAsync(userdata, tmp.constData(), MPV_FORMAT_NODE);
+    if(error < 0)
+        Fail(userdata, error);
+}
+
+void MpvHandler::GetPropertiesAsync(const QStringList &names, Values then)
+{
+    // mpv works through them on its own; whichever answers last hands over the lot
+    auto values = std::make_shared<QVariantMap>();
+    auto left = std::make_shared<int>(names.length());
+    for(auto &name : names)
+        GetPropertyAsync(name,
+                         [=](int error, const QVariant &value)
+                         {
+                             if(error >= 0)
+                                 (*values)[name] = value;
+                             if(--*left == 0)
+                                 then(*values);
+                         });
+}
+
+quint64 MpvHandler::Request(mpv_event_id reply, QString name, Reply then)
+{
+    if(!then)
+        return 0;
+    requests[nextRequest] = Pending{reply, name, then};
+    return nextRequest++;
+}
+
+void MpvHandler::Answer(mpv_event *event)
+{
+    if(event->reply_userdata < MPV_REPLY_REQUEST)
+        return;
+    mpv_event_property *prop = nullptr;
+    QString name;
+    if(event->event_id == MPV_EVENT_GET_PROPERTY_REPLY && event->data != nullptr)
+    {
+        prop = static_cast<mpv_event_property*>(event->data);
+        name = QString::fromUtf8(prop->name);
+    }
+    auto matches = [&](const Pending &p) { return p.reply == event->event_id && p.name == name; };
+    // mpv answers each request with its own userdata, but a replay only has the order it was
+    //  recorded in: a reply that isn't for what was asked goes to the oldest request it is for,
+    //  and the request it came in for is failed rather than left waiting forever
+    auto i = requests.find(event->reply_userdata);
+    if(i == requests.end() || !matches(*i))
+    {
+        if(i != requests.end())
+            Fail(i.key(), MPV_ERROR_GENERIC);
+        i = requests.end();
+        for(auto j = requests.begin(); j != requests.end(); ++j)
+            if(matches(*j) && (i == requests.end() || j.key() < i.key()))
+                i = j;
+        if(i == requests.end())
+            return;
+    }
+    Reply then = i->then;
+    requests.erase(i);
+    QVariant result;
+    if(event->error >= 0 && event->data != nullptr)
+    {
+        if(event->event_id == MPV_EVENT_COMMAND_REPLY)
+            result = MpvClient::ToVariant(static_cast<mpv_event_command*>(event->data)->result);
+        else
+            result = MpvClient::ToVariant(prop->format, prop->data);
+    }
+    then(event->error, result);
+}
+
+void MpvHandler::Fail(quint64 userdata, int error)
+{
+    Reply then = requests.take(userdata).then;
+    if(!then)
+    {
+        HandleErrorCode(error);
+        return;
+    }
+    // continuations always run from the event loop, never inside the call that asked
+    QTimer::singleShot(0, this,
+                       [=]
+                       {
+                           then(error, QVariant());
+                       });
+}
+
+void MpvHandler::Observe(QString name)
+{
+    if(observed.contains(name))
+        return;
+    // each property gets its own userdata so it can be dropped without touching the others
+    const QByteArray tmp = name.toUtf8();
+    observed[name] = nextObserve;
+    HandleErrorCode(mpv->ObserveProperty(nextObserve++, tmp.constData(), MPV_FORMAT_NODE));
+}
+
+void MpvHandler::Unobserve(QString name)
+{
+    auto iter = observed.find(name);
+    if(iter == observed.end())
+        return;
+    mpv->UnobserveProperty(*iter);
+    observed.erase(iter);
+}
+
 void MpvHandler::SetOption(QString key, QString val)
 {
     QByteArray tmp1 = key.toUtf8(),
                tmp2 = val.toUtf8();
-    HandleErrorCode(mpv_set_option_string(mpv, tmp1.constData(), tmp2.constData()));
+    if(running) // an option is a property once mpv runs, and setting it waits on the core
+    {
+        char *data = tmp2.data();
+        mpv->SetPropertyAsync(MPV_REPLY_PROPERTY, tmp1.constData(), MPV_FORMAT_STRING, &data);
+    }
+    else
+        HandleErrorCode(mpv->SetOptionString(tmp1.constData(), tmp2.constData()));
 }
 
-void MpvHandler::OpenFile(QString f)
+void MpvHandler::OpenFile(QString f, QString options)
 {
+    BAKA_TRACE("MpvHandler::OpenFile");
     emit fileChanging(time, fileInfo.length);
 
-    const QByteArray tmp = f.toUtf8();
-    const char *args[] = {"loadfile", tmp.constData(), NULL};
-    Command(args);
+    // mpv 0.38 put an insertion index before the options; -1 is what replace ignores anyway.
+    //  it's the libmpv we run with that reads them, not the headers we were built against
+    static const bool index = mpv_client_api_version() >= MPV_MAKE_VERSION(2, 3);
+    if(options == QString())
+        CommandAsync({"loadfile", f});
+    else if(index)
+        CommandAsync({"loadfile", f, "replace", "-1", options});
+    else
+        CommandAsync({"loadfile", f, "replace", options});
 }
 
 QString MpvHandler::PopulatePlaylist()
 {
+    BAKA_TRACE("MpvHandler::PopulatePlaylist");
     if(path != "")
     {
         QStringList playlist;
@@ -908,6 +1295,76 @@ QString MpvHandler::PopulatePlaylist()
     return QString();
 }
 
+void MpvHandler::LoadCacheState(const mpv_node &node)
+{
+    Mpv::CacheState state;
+    if(node.format == MPV_FORMAT_NODE_MAP)
+    {
+        for(int i = 0; i < node.u.list->num; i++)
+        {
+            QString key = node.u.list->keys[i];
+            const mpv_node &value = node.u.list->values[i];
+            if(key == "seekable-ranges")
+            {
+                if(value.format == MPV_FORMAT_NODE_ARRAY)
+                {
+                    for(int n = 0; n < value.u.list->num; n++)
+                    {
+                        const mpv_node &range = value.u.list->values[n];
+                        if(range.format != MPV_FORMAT_NODE_MAP)
+                            continue;
+                        double start = 0, end = 0;
+                        for(int r = 0; r < range.u.list->num; r++)
+                        {
+                            if(range.u.list->values[r].format != MPV_FORMAT_DOUBLE)
+                                continue;
+                            if(QString(range.u.list->keys[r]) == "start")
+                                start = range.u.list->values[r].u.double_;
+                            else if(QString(range.u.list->keys[r]) == "end")
+                                end = range.u.list->values[r].u.double_;
+                        }
+                        state.ranges.push_back({start, end});
+                    }
+                }
+            }
+            else if(key == "cache-duration")
+            {
+                if(value.format == MPV_FORMAT_DOUBLE)
+                    state.duration = value.u.double_;
+            }
+            else if(key == "fw-bytes")
+            {
+                if(value.format == MPV_FORMAT_INT64)
+                    state.fwBytes = value.u.int64;
+            }
+            else if(key == "total-bytes")
+            {
+                if(value.format == MPV_FORMAT_INT64)
+                    state.totalBytes = value.u.int64;
+            }
+            else if(key == "raw-input-rate")
+            {
+                if(value.format == MPV_FORMAT_INT64)
+                    state.inputRate = value.u.int64;
+            }
+            else if(key == "eof")
+            {
+                if(value.format == MPV_FORMAT_FLAG)
+                    state.eof = value.u.flag;
+            }
+        }
+    }
+    setCacheState(state);
+}
+
+bool MpvHandler::IsCached(int t)
+{
+    for(auto &range : cacheState.ranges)
+        if(t >= range.first && t <= range.second)
+            return true;
+    return false;
+}
+
 void MpvHandler::SetProperties()
 {
     Volume(volume);
@@ -917,12 +1374,7 @@ void MpvHandler::SetProperties()
 
 void MpvHandler::AsyncCommand(const char *args[])
 {
-    mpv_command_async(mpv, MPV_REPLY_COMMAND, args);
-}
-
-void MpvHandler::Command(const char *args[])
-{
-    HandleErrorCode(mpv_command(mpv, args));
+    mpv->CommandAsync(MPV_REPLY_COMMAND, args);
 }
 
 void MpvHandler::HandleErrorCode(int error_code)
@@ -4,13 +4,20 @@
 #include <QObject>
 #include <QString>
 #include <QStringList>
+#include <QVariant>
+#include <QHash>
 
-#include <mpv/client.h>
+#include <future>
+#include <functional>
+#include <atomic>
 
+#include "mpvclient.h"
 #include "mpvtypes.h"
 
 #define MPV_REPLY_COMMAND 1
 #define MPV_REPLY_PROPERTY 2
+#define MPV_REPLY_OBSERVE 16 // and up: one per property watched through Observe()
+#define MPV_REPLY_REQUEST (quint64(1) << 32) // and up: one per request made through the async api
 
 class BakaEngine;
 
@@ -22,8 +29,9 @@ public:
     explicit MpvHandler(int64_t wid, QObject *parent = 0);
     ~MpvHandler();
 
-    void Initialize();
+    void Initialize(); // returns right away; initialized() follows
     const Mpv::FileInfo &getFileInfo()      { return fileInfo; }
+    const Mpv::CacheState &getCacheState()  { return cacheState; }
     Mpv::PlayState getPlayState()           { return playState; }
     QString getFile()                       { return file; }
     QString getPath()                       { return path; }
@@ -44,7 +52,21 @@ public:
     int getOsdWidth()                       { return osdWidth; }
     int getOsdHeight()                      { return osdHeight; }
 
-    QString getMediaInfo();
+    // the async api: calls return right away, and the continuation runs on the gui thread, from
+    //  the event dispatcher, once mpv has answered; with mpv's error code and the result as a plain
+    //  variant (maps, lists, strings and numbers). the gui thread goes through these: mpv's core can
+    //  be busy for seconds (opening a network stream, say), and the blocking calls wait for it.
+    typedef std::function<void(int error, const QVariant &result)> Reply;
+    typedef std::function<void(const QVariantMap &values)> Values; // what couldn't be read is left out
+
+    void CommandAsync(const QStringList &args, Reply then = Reply());
+    void GetPropertyAsync(QString name, Reply then);
+    void GetPropertiesAsync(const QStringList &names, Values then); // all at once; then runs after the last
+
+    void MediaInfo(std::function<void(QString)> then); // the text for the media info overlay
+    void LoadVideoParams(std::function<void()> then);   // then runs once getFileInfo() has them
+    // mpv reads the image at file when it draws; it has to stay put until then says it's been replaced
+    void AddOverlay(int id, int x, int y, QString file, int offset, int w, int h, Reply then = Reply());
 
 protected:
     virtual bool event(QEvent*);
@@ -55,9 +77,11 @@ public slots:
     void LoadFile(QString);
     QString LoadPlaylist(QString);
     bool PlayFile(QString);
+    void Restore(QString path, const QStringList &playlist, QString file, int time, int vid, int aid, int sid);
 
-    void AddOverlay(int id, int x, int y, QString file, int offset, int w, int h);
     void RemoveOverlay(int id);
+    void OsdOverlay(int id, QString ass, int w, int h);
+    void RemoveOsdOverlay(int id);
 
     void Play();
     void Pause();
@@ -98,7 +122,7 @@ public slots:
     void Interpolate(bool);
     void Vo(QString);
 
-    void MsgLevel(QString level);
+    void MsgLevel(QString level); // "level" or per-module rules, eg. "vd=debug,all=warn"
 
     void ShowText(QString text, int duration = 4000);
 
@@ -112,19 +136,37 @@ public slots:
     void Command(const QStringList &strlist);
     void SetOption(QString key, QString val);
 
+    // blocking, with results as plain variants; both return an mpv error code. not for the gui
+    //  thread once mpv is running (debug builds assert it), that's what the async api is for
+    int CommandNode(const QStringList &args, QVariant &result);
+    int GetProperty(QString name, QVariant &value);
+    void Observe(QString name);     // observedPropertyChanged() from now on, starting with the current value
+    void Unobserve(QString name);
+
 protected slots:
-    void OpenFile(QString);
+    void OpenFile(QString f, QString options = QString()); // options are per-file, eg. "start=10,aid=2"
     QString PopulatePlaylist();
     void LoadFileInfo();
     void SetProperties();
+    void LoadCacheState(const mpv_node &node);
+    bool IsCached(int time);
+    bool LogEnabled(const char *prefix, int level);
+
+    QString MediaInfoText(const QVariantMap &values);
+    void SetTracks(const QVariant &list);
+    void SetChapters(const QVariant &list);
+    void SetVideoParams(const QVariantMap &values);
+    void SetAudioParams(const QVariantMap &values);
+    void SetMetadata(const QVariant &map);
+    void AddTrack(QString command, QString f);
 
     void AsyncCommand(const char *args[]);
-    void Command(const char *args[]);
     void HandleErrorCode(int);
 
 private slots:
     void setPlaylist(const QStringList& l)  { emit playlistChanged(l); }
     void setFileInfo()                      { emit fileInfoChanged(fileInfo); }
+    void setCacheState(const Mpv::CacheState &s) { emit cacheStateChanged(cacheState = s); }
     void setPlayState(Mpv::PlayState s)     { emit playStateChanged(playState = s); }
     void setFile(QString s)                 { emit fileChanged(file = s); }
     void setPath(QString s)                 { emit pathChanged(path = s); }
@@ -146,11 +188,13 @@ private slots:
 signals:
     void playlistChanged(const QStringList&);
     void fileInfoChanged(const Mpv::FileInfo&);
+    void cacheStateChanged(const Mpv::CacheState&);
     void trackListChanged(const QList<Mpv::Track>&);
     void chaptersChanged(const QList<Mpv::Chapter>&);
     void videoParamsChanged(const Mpv::VideoParams&);
     void audioParamsChanged(const Mpv::AudioParams&);
     void playStateChanged(Mpv::PlayState);
+    void playbackRestarted(); // a frame is up after a load or seek
     void fileChanging(int, int);
     void fileChanged(QString);
     void pathChanged(QString);
@@ -171,14 +215,46 @@ signals:
     void muteChanged(bool);
 
     void messageSignal(QString m);
+    void logMessage(const Mpv::LogMessage &m);
+    void clientMessage(const QStringList &args); // script-message and replays (see replay.h)
+
+    void initialized(bool ok); // from the worker; connect with a receiver to get it on your thread
+    void observedPropertyChanged(QString name, const QVariant &value);
 
 private:
+    // a request mpv hasn't answered yet: what it asked for ("" for a command), and what to run then
+    struct Pending
+    {
+        mpv_event_id reply;
+        QString name;
+        Reply then;
+    };
+    quint64 Request(mpv_event_id reply, QString name, Reply then); // the userdata; 0 without a continuation
+    void Answer(mpv_event *event);          // runs a request's continuation
+    void Fail(quint64 userdata, int error); // a request mpv wouldn't take
+
     BakaEngine *baka;
-    mpv_handle *mpv = nullptr;
+    MpvClient *mpv = nullptr;   // libmpv, or a stand-in (see mpvclient.h)
+    std::future<void> initializing;
+    std::atomic<bool> running{false};   // initialized; blocking calls would wait on the core from now on
+    QHash<quint64, Pending> requests;   // userdata -> continuation
+    quint64 nextRequest = MPV_REPLY_REQUEST;
+    quint64 loaded = 0; // goes up as a file starts and ends; replies about the one before are dropped
+    QHash<QString, quint64> observed; // property -> reply userdata
+    quint64 nextObserve = MPV_REPLY_OBSERVE;
 
     // variables
     Mpv::PlayState playState = Mpv::Idle;
     Mpv::FileInfo fileInfo;
+    Mpv::CacheState cacheState;
+    // msg-level rules; messages are checked against these before we touch them
+    struct LogRule
+    {
+        QByteArray prefix;
+        int level;
+    };
+    QList<LogRule> logRules;
+    int         logLevel = MPV_LOG_LEVEL_INFO; // level for modules without a rule ("all")
     QString     file,
                 path,
                 screenshotFormat,
@@ -196,6 +272,7 @@ private:
                 aid,
                 sid;
     bool        init = false,
+                cachedSeek = false,
                 playlistVisible = false,
                 subtitleVisibility = true,
                 mute = false;
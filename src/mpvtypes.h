@@ -6,6 +6,7 @@
 #include <QStringList>
 #include <QMap>
 #include <QList>
+#include <QPair>
 
 namespace Mpv
 {
@@ -64,6 +65,24 @@ namespace Mpv
             channels;
     };
 
+    struct CacheState
+    {
+        QList<QPair<double, double>> ranges; // seekable (start, end) times held by the demuxer cache
+        double duration = 0;    // seconds cached ahead of the playback position
+        qint64 fwBytes = 0,     // bytes cached ahead of the playback position
+               totalBytes = 0,  // bytes held by the cache in total
+               inputRate = 0;   // bytes/s currently coming in from the network
+        bool eof = false;
+    };
+
+    struct LogMessage
+    {
+        qint64 time = 0;    // mpv_get_time_us() when the message reached us
+        int level = 0;      // mpv_log_level
+        QString prefix,     // module that logged it (eg. "vd", "cplayer")
+                text;
+    };
+
     struct FileInfo
     {
         QString media_title;
@@ -81,6 +100,8 @@ Q_DECLARE_METATYPE(Mpv::Track)
 Q_DECLARE_METATYPE(Mpv::VideoParams)
 Q_DECLARE_METATYPE(Mpv::AudioParams)
 Q_DECLARE_METATYPE(Mpv::FileInfo)
+Q_DECLARE_METATYPE(Mpv::CacheState)
+Q_DECLARE_METATYPE(Mpv::LogMessage)
 
 
 #endif // MPVTYPES_H
@@ -13,6 +13,8 @@ public:
     explicit Overlay(QLabel *label, QImage *canvas, QTimer *timer, QObject *parent = 0);
     ~Overlay();
 
+    QImage *releaseCanvas() { QImage *c = canvas; canvas = nullptr; return c; } // it's yours to delete
+
 private:
     QLabel *label;
     QImage *canvas;
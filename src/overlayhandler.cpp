@@ -6,6 +6,7 @@
 #include "ui_mainwindow.h"
 #include "util.h"
 #include "overlay.h"
+#include "tracing.h"
 
 #include <QFileInfo>
 #include <QPainter>
@@ -14,6 +15,7 @@
 #include <QBrush>
 #include <QTimer>
 #include <QFontMetrics>
+#include <QFontInfo>
 #include <QThread>
 
 #define OVERLAY_INFO 62
@@ -26,7 +28,8 @@ OverlayHandler::OverlayHandler(QObject *parent):
     refresh_timer(nullptr),
     min_overlay(1),
     max_overlay(60),
-    overlay_id(min_overlay)
+    overlay_id(min_overlay),
+    nativeOsd(true)
 {
 }
 
@@ -34,12 +37,50 @@ OverlayHandler::~OverlayHandler()
 {
     for(auto o : overlays)
         delete o;
+    for(auto t : osd_overlays)
+        if(t != nullptr)
+            delete t;
+}
+
+// escape text so that libass doesn't interpret it as override tags
+static QString EscapeAss(const QString &text)
+{
+    QString ass;
+    ass.reserve(text.length());
+    for(auto c : text)
+    {
+        if(c == '\\')
+            ass += QString("\\")+QChar(0x2060); // word joiner breaks up escape sequences
+        else if(c == '{')
+            ass += "\\{";
+        else if(c == '}')
+            ass += "\\}";
+        else if(c == '\n')
+            ass += "\\N";
+        else
+            ass += c;
+    }
+    return ass;
+}
+
+void OverlayHandler::setNativeOsd(bool b)
+{
+    if(nativeOsd == b)
+        return;
+    // clear whatever the old backend was showing
+    for(auto id : overlays.keys())
+        remove(id);
+    for(auto id : osd_overlays.keys())
+        remove(id);
+    nativeOsd = b;
+    if(refresh_timer != nullptr) // media info is showing, redraw it with the new backend
+        showInfoText();
 }
 
 void OverlayHandler::showStatusText(const QString &text, int duration)
 {
     if(text != QString())
-        showText(text,
+        showOsdText(text,
                  QFont(Util::MonospaceFont(),
                        14, QFont::Bold), QColor(0xFFFFFF),
                  QPoint(20, 20), duration, OVERLAY_STATUS);
@@ -59,10 +100,15 @@ void OverlayHandler::showInfoText(bool show)
                     [=] { showInfoText(); });
         }
         refresh_timer->start(OVERLAY_REFRESH_RATE);
-        showText(baka->mpv->getMediaInfo(),
-                 QFont(Util::MonospaceFont(),
-                       14, QFont::Bold), QColor(0xFFFF00),
-                 QPoint(20, 20), 0, OVERLAY_INFO);
+        baka->mpv->MediaInfo([=](QString info)
+                             {
+                                 if(refresh_timer == nullptr) // hidden meanwhile
+                                     return;
+                                 showOsdText(info,
+                                          QFont(Util::MonospaceFont(),
+                                                14, QFont::Bold), QColor(0xFFFF00),
+                                          QPoint(20, 20), 0, OVERLAY_INFO);
+                             });
     }
     else // hide media info
     {
@@ -72,8 +118,56 @@ void OverlayHandler::showInfoText(bool show)
     }
 }
 
+void OverlayHandler::showOsdText(const QString &text, QFont font, QColor color, QPoint pos, int duration, int id)
+{
+    if(nativeOsd)
+        showAssText(text, font, color, pos, duration, id);
+    else
+        showText(text, font, color, pos, duration, id);
+}
+
+void OverlayHandler::showAssText(const QString &text, QFont font, QColor color, QPoint pos, int duration, int id)
+{
+    BAKA_TRACE("OverlayHandler::showAssText");
+    overlay_mutex.lock();
+    // mpv renders the text itself at display resolution; we just describe it as an ass event.
+    //  the script resolution is the frame size so positions match the qt overlays
+    QString ass = QString("{\\an7\\pos(%0,%1)\\fn%2\\fs%3\\b%4\\bord1\\shad0\\1c&H%5&\\3c&H000000&}").arg(
+                QString::number(pos.x()),
+                QString::number(pos.y()),
+                font.family(),
+                QString::number(QFontInfo(font).pixelSize()),
+                font.bold() ? "1" : "0",
+                QString("%1%2%3").arg(color.blue(), 2, 16, QChar('0'))
+                                 .arg(color.green(), 2, 16, QChar('0'))
+                                 .arg(color.red(), 2, 16, QChar('0')).toUpper()) +
+            EscapeAss(text);
+
+    baka->mpv->OsdOverlay(id, ass,
+                          baka->window->ui->mpvFrame->width(),
+                          baka->window->ui->mpvFrame->height());
+
+    QTimer *timer;
+    if(duration == 0)
+        timer = nullptr;
+    else
+    {
+        timer = new QTimer(this);
+        timer->start(duration);
+        connect(timer, &QTimer::timeout, // on timeout
+                [=] { remove(id); });
+    }
+
+    auto iter = osd_overlays.find(id);
+    if(iter != osd_overlays.end() && *iter != nullptr)
+        delete *iter;
+    osd_overlays[id] = timer;
+    overlay_mutex.unlock();
+}
+
 void OverlayHandler::showText(const QString &text, QFont font, QColor color, QPoint pos, int duration, int id)
 {
+    BAKA_TRACE("OverlayHandler::showText");
     overlay_mutex.lock();
     // increase next overlay_id
     if(id == -1) // auto id
@@ -121,13 +215,6 @@ void OverlayHandler::showText(const QString &text, QFont font, QColor color, QPo
     painter.setBrush(color);
     painter.drawPath(path);
 
-    // add as mpv overlay
-    baka->mpv->AddOverlay(
-        id == -1 ? overlay_id : id,
-        pos.x(), pos.y(),
-        "&"+QString::number(quintptr(canvas->bits())),
-        0, canvas->width(), canvas->height());
-
     // add over mpv as label
     QLabel *label = new QLabel(baka->window->ui->mpvFrame);
     label->setStyleSheet("background-color:rgb(0,0,0,0);background-image:url();");
@@ -149,16 +236,41 @@ void OverlayHandler::showText(const QString &text, QFont font, QColor color, QPo
                 [=] { remove(id); });
     }
 
+    // mpv draws from the old canvas until it has taken the new one
+    QImage *old = nullptr;
     if(overlays.find(id) != overlays.end())
+    {
+        old = overlays[id]->releaseCanvas();
         delete overlays[id];
+    }
     overlays[id] = new Overlay(label, canvas, timer, this);
+
+    // add as mpv overlay
+    baka->mpv->AddOverlay(
+        id == -1 ? overlay_id : id,
+        pos.x(), pos.y(),
+        "&"+QString::number(quintptr(canvas->bits())),
+        0, canvas->width(), canvas->height(),
+        [=](int, const QVariant&)
+        {
+            delete old;
+        });
     overlay_mutex.unlock();
 }
 
 void OverlayHandler::remove(int id)
 {
     overlay_mutex.lock();
-    baka->mpv->RemoveOverlay(id);
+    auto iter = osd_overlays.find(id);
+    if(iter != osd_overlays.end())
+    {
+        baka->mpv->RemoveOsdOverlay(id);
+        if(*iter != nullptr)
+            (*iter)->deleteLater(); // we might be inside its timeout
+        osd_overlays.erase(iter);
+    }
+    else
+        baka->mpv->RemoveOverlay(id);
     if(overlays.find(id) != overlays.end())
     {
         delete overlays[id];
@@ -21,24 +21,32 @@ public:
     explicit OverlayHandler(QObject *parent = 0);
     ~OverlayHandler();
 
+    bool getNativeOsd() { return nativeOsd; }
+
 public slots:
+    void setNativeOsd(bool b);
+
     void showStatusText(const QString &text, int duration = 4000);
     void showInfoText(bool show = true);
     void showText(const QString &text, QFont font, QColor color, QPoint pos, int duration, int id = -1);
+    void showAssText(const QString &text, QFont font, QColor color, QPoint pos, int duration, int id);
 
 protected slots:
+    void showOsdText(const QString &text, QFont font, QColor color, QPoint pos, int duration, int id);
     void remove(int id);
 
 private:
     BakaEngine *baka;
 
     QHash<int, Overlay*> overlays;
+    QHash<int, QTimer*> osd_overlays; // ass text rendered by mpv (timer is nullptr if it doesn't expire)
     QMutex overlay_mutex;
 
     QTimer *refresh_timer;
     int min_overlay,
         max_overlay,
         overlay_id;
+    bool nativeOsd;
 };
 
 #endif // OVERLAYHANDLER_H
@@ -24,6 +24,9 @@ QString DownloadFileUrl()
 
 bool DimLightsSupported()
 {
+    // no x server to ask on other platforms (offscreen for --headless, wayland)
+    if(!QX11Info::isPlatformX11() || QX11Info::display() == nullptr)
+        return false;
     QString tmp = "_NET_WM_CM_S"+QString::number(QX11Info::appScreen());
     Atom a = XInternAtom(QX11Info::display(), tmp.toUtf8().constData(), false);
     if(a && XGetSelectionOwner(QX11Info::display(), a)) // hack for QX11Info::isCompositingManagerRunning()
@@ -34,6 +37,8 @@ bool DimLightsSupported()
 void SetAlwaysOnTop(WId wid, bool ontop)
 {
     Display *display = QX11Info::display();
+    if(!QX11Info::isPlatformX11() || display == nullptr)
+        return;
     XEvent event;
     event.xclient.type = ClientMessage;
     event.xclient.serial = 0;
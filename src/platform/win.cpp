@@ -4,6 +4,7 @@
 #include <QRegExp>
 #include <QProcess>
 #include <QDir>
+#include <QStandardPaths>
 
 #include <windows.h>
 
@@ -33,6 +34,8 @@ void SetAlwaysOnTop(WId wid, bool ontop)
 QString SettingsLocation()
 {
     // saves to $(application directory)\${SETTINGS_FILE}.ini
+    if(QStandardPaths::isTestModeEnabled()) // benchmark runs; not the user's settings
+        return QString("%0\\%1.ini").arg(QStandardPaths::writableLocation(QStandardPaths::ConfigLocation), SETTINGS_FILE);
     return QString("%0\\%1.ini").arg(QApplication::applicationDirPath(), SETTINGS_FILE);
 }
 
@@ -0,0 +1,160 @@
+#include "recording.h"
+
+#include <QCoreApplication>
+#include <QStringList>
+#include <QFile>
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QMutexLocker>
+
+namespace Recording {
+
+static QMutex mutex;
+static QFile *file = nullptr;
+static QDataStream *out = nullptr;
+static QElapsedTimer clock;
+
+// starts a record; call with the mutex held and the recording active
+static QDataStream &Begin(char type)
+{
+    return *out << quint8(type) << qint64(clock.nsecsElapsed()/1000);
+}
+
+QString Requested()
+{
+    for(auto &arg : QCoreApplication::arguments())
+        if(arg.startsWith("--record="))
+            return arg.section('=', 1);
+    return QString();
+}
+
+bool IsActive()
+{
+    QMutexLocker locker(&mutex);
+    return out != nullptr;
+}
+
+bool Start(QString f)
+{
+    QMutexLocker locker(&mutex);
+    if(out != nullptr)
+        return false;
+    file = new QFile(f);
+    if(!file->open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        delete file;
+        file = nullptr;
+        return false;
+    }
+    out = new QDataStream(file);
+    out->setVersion(QDataStream::Qt_5_0);
+    *out << quint32(RECORDING_MAGIC) << quint32(RECORDING_VERSION);
+    clock.start();
+    return true;
+}
+
+void Stop()
+{
+    QMutexLocker locker(&mutex);
+    if(out == nullptr)
+        return;
+    delete out;
+    out = nullptr;
+    file->close();
+    delete file;
+    file = nullptr;
+}
+
+void Command(QString command)
+{
+    QMutexLocker locker(&mutex);
+    if(out != nullptr)
+        Begin('c') << command.toUtf8();
+}
+
+void Key(int key, int modifiers)
+{
+    QMutexLocker locker(&mutex);
+    if(out != nullptr)
+        Begin('k') << qint32(key) << qint32(modifiers);
+}
+
+static void Event(const mpv_event *event)
+{
+    QMutexLocker locker(&mutex);
+    if(out == nullptr)
+        return;
+    QDataStream &s = Begin('e') << quint32(event->event_id) << quint64(event->reply_userdata) << qint32(event->error);
+    switch(event->event_id)
+    {
+    case MPV_EVENT_PROPERTY_CHANGE:
+    case MPV_EVENT_GET_PROPERTY_REPLY:
+    {
+        mpv_event_property *prop = static_cast<mpv_event_property*>(event->data);
+        s << QByteArray(prop->name) << qint32(prop->format) << MpvClient::ToVariant(prop->format, prop->data);
+        break;
+    }
+    case MPV_EVENT_COMMAND_REPLY:
+        s << (event->data != nullptr ? MpvClient::ToVariant(static_cast<mpv_event_command*>(event->data)->result) : QVariant());
+        break;
+    case MPV_EVENT_LOG_MESSAGE:
+    {
+        mpv_event_log_message *message = static_cast<mpv_event_log_message*>(event->data);
+        s << QByteArray(message->prefix) << qint32(message->log_level) << QByteArray(message->text);
+        break;
+    }
+    case MPV_EVENT_CLIENT_MESSAGE:
+    {
+        mpv_event_client_message *message = static_cast<mpv_event_client_message*>(event->data);
+        QList<QByteArray> args;
+        for(int i = 0; i < message->num_args; ++i)
+            args.append(QByteArray(message->args[i]));
+        s << args;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static void Property(const char *name, int error, const QVariant &value)
+{
+    QMutexLocker locker(&mutex);
+    if(out != nullptr)
+        Begin('p') << QByteArray(name) << qint32(error) << value;
+}
+
+}
+
+RecordingMpvClient::~RecordingMpvClient()
+{
+    delete client;
+    Recording::Stop();
+}
+
+mpv_event *RecordingMpvClient::WaitEvent(double timeout)
+{
+    mpv_event *event = client->WaitEvent(timeout);
+    if(event != nullptr && event->event_id != MPV_EVENT_NONE)
+        Recording::Event(event);
+    return event;
+}
+
+int RecordingMpvClient::GetProperty(const char *name, mpv_format format, void *data)
+{
+    // replays need what was read, not just what was sent; a failed read too
+    int error = client->GetProperty(name, format, data);
+    Recording::Property(name, error, error >= 0 ? MpvClient::ToVariant(format, data) : QVariant());
+    return error;
+}
+
+char *RecordingMpvClient::GetPropertyString(const char *name)
+{
+    char *value = client->GetPropertyString(name);
+    if(value != nullptr)
+        Recording::Property(name, 0, QString::fromUtf8(value));
+    else // mpv doesn't say why
+        Recording::Property(name, MPV_ERROR_PROPERTY_UNAVAILABLE, QVariant());
+    return value;
+}
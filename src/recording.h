@@ -0,0 +1,72 @@
+#ifndef RECORDING_H
+#define RECORDING_H
+
+#include <QString>
+#include <QVariant>
+
+#include "mpvclient.h"
+
+#define RECORDING_MAGIC 0x424b5243 // "BKRC"
+#define RECORDING_VERSION 3 // 1 had no replies to asynchronous gets and commands, 2 no failed reads
+
+// --record=<file>: logs what drives the player, with timestamps, to a compact binary file
+//  that --replay=<file> plays back through the fake mpv (see fakempv.h):
+//   - every event mpv sends, and the values of the properties the player reads
+//   - baka commands, whatever they came from (console, scripts, the control socket, key bindings,
+//     menu actions; see BakaEngine::Dispatch), and key presses that aren't bound to one
+// records are QDataStream: quint8 type, qint64 microseconds since the start, then
+//  'e' event:    quint32 id, quint64 userdata, qint32 error, and for property changes and
+//                get replies the name (utf-8), qint32 format and value; command replies the
+//                result; log messages prefix, qint32 level, text; client messages their arguments
+//  'p' property: name, qint32 error, value (as read; invalid if the read failed)
+//  'c' command:  the command (utf-8)
+//  'k' key:      qint32 key, qint32 modifiers
+namespace Recording {
+
+QString Requested();        // the file from --record=<file>, if any
+bool IsActive();
+bool Start(QString file);
+void Stop();
+
+void Command(QString command);
+void Key(int key, int modifiers);
+
+}
+
+// records what passes through another client on its way to the player
+class RecordingMpvClient : public MpvClient
+{
+public:
+    explicit RecordingMpvClient(MpvClient *client): client(client) {}
+    ~RecordingMpvClient();
+
+    int Initialize()                                    { return client->Initialize(); }
+    void SetWakeupCallback(void (*callback)(void*), void *ctx) { client->SetWakeupCallback(callback, ctx); }
+    mpv_event *WaitEvent(double timeout);
+    int RequestLogMessages(const char *level)           { return client->RequestLogMessages(level); }
+    int64_t GetTimeUs()                                 { return client->GetTimeUs(); }
+
+    int SetOption(const char *name, mpv_format format, void *data) { return client->SetOption(name, format, data); }
+    int SetOptionString(const char *name, const char *data) { return client->SetOptionString(name, data); }
+
+    int Command(const char **args)                      { return client->Command(args); }
+    int CommandAsync(uint64_t userdata, const char **args) { return client->CommandAsync(userdata, args); }
+    int CommandNode(mpv_node *args, mpv_node *result)   { return client->CommandNode(args, result); }
+    int CommandNodeAsync(uint64_t userdata, mpv_node *args) { return client->CommandNodeAsync(userdata, args); }
+
+    int GetProperty(const char *name, mpv_format format, void *data);
+    char *GetPropertyString(const char *name);
+    int GetPropertyAsync(uint64_t userdata, const char *name, mpv_format format) { return client->GetPropertyAsync(userdata, name, format); }
+    int SetPropertyString(const char *name, const char *data) { return client->SetPropertyString(name, data); }
+    int SetPropertyAsync(uint64_t userdata, const char *name, mpv_format format, void *data) { return client->SetPropertyAsync(userdata, name, format, data); }
+    int ObserveProperty(uint64_t userdata, const char *name, mpv_format format) { return client->ObserveProperty(userdata, name, format); }
+    int UnobserveProperty(uint64_t userdata)            { return client->UnobserveProperty(userdata); }
+
+    void FreeNodeContents(mpv_node *node)               { client->FreeNodeContents(node); }
+    void Free(void *data)                               { client->Free(data); }
+
+private:
+    MpvClient *client;
+};
+
+#endif // RECORDING_H
@@ -0,0 +1,147 @@
+#include "replay.h"
+
+#include <QCoreApplication>
+#include <QKeyEvent>
+#include <QFile>
+#include <QTextStream>
+#include <QJsonDocument>
+
+#include <chrono>
+
+#include "bakaengine.h"
+#include "mpvhandler.h"
+#include "ui/mainwindow.h"
+#include "util.h"
+
+#define REPLAY_SAMPLE_RATE 10 // ms between event loop latency probes
+
+QString Replay::Requested()
+{
+    for(auto &arg : QCoreApplication::arguments())
+        if(arg.startsWith("--replay="))
+            return arg.section('=', 1);
+    return QString();
+}
+
+qint64 Replay::Clock()
+{
+    // steady, and the same on every thread
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Replay::Replay(QObject *parent):
+    QObject(parent),
+    baka(static_cast<BakaEngine*>(parent)),
+    sampler(new QTimer(this)),
+    commands(0),
+    keys(0),
+    finished(false)
+{
+    clock.start();
+    lastSample = clock.nsecsElapsed();
+    connect(sampler, &QTimer::timeout,
+            this, &Replay::Sample);
+    connect(baka->mpv, &MpvHandler::clientMessage,
+            this, &Replay::ClientMessage);
+    // the recording may well end with the player being quit
+    connect(qApp, &QCoreApplication::aboutToQuit,
+            this, &Replay::Finish);
+    sampler->start(REPLAY_SAMPLE_RATE);
+}
+
+void Replay::ClientMessage(const QStringList &args)
+{
+    if(args.value(0) != "baka-replay")
+        return;
+    QString what = args.value(1);
+    if(what == "command" || what == "key") // the last argument is when it went out
+        lag.append(qMax(0.0, (Clock()-args.last().toLongLong())/1000.0));
+    if(what == "command")
+    {
+        ++commands;
+        baka->Command(args.value(2));
+    }
+    else if(what == "key")
+    {
+        ++keys;
+        // through the window like a real one, and done with before the next message
+        QKeyEvent event(QEvent::KeyPress, args.value(2).toInt(), Qt::KeyboardModifiers(args.value(3).toInt()));
+        QCoreApplication::sendEvent(baka->window, &event);
+    }
+    else if(what == "end")
+        Finish();
+}
+
+void Replay::Sample()
+{
+    // the timer fires late by however long the event loop was busy
+    qint64 now = clock.nsecsElapsed();
+    latency.append(qMax(0.0, (now-lastSample)/1000000.0-REPLAY_SAMPLE_RATE));
+    lastSample = now;
+}
+
+void Replay::Finish()
+{
+    if(finished)
+        return;
+    finished = true;
+    sampler->stop();
+    QJsonObject report;
+    report["recording"] = Requested();
+    report["seconds"] = clock.nsecsElapsed()/1000000000.0;
+    report["commands"] = commands;
+    report["keys"] = keys;
+    report["latency_ms"] = Util::Stats(latency);
+    report["lag_ms"] = Util::Stats(lag);
+    QJsonObject root;
+    root["replay"] = report;
+    (qStdout() << QJsonDocument(root).toJson(QJsonDocument::Compact) << "\n").flush();
+    QJsonObject compare = Compare(report);
+    if(!compare.isEmpty())
+    {
+        QJsonObject line;
+        line["compare"] = compare;
+        (qStdout() << QJsonDocument(line).toJson(QJsonDocument::Compact) << "\n").flush();
+    }
+    QCoreApplication::quit();
+}
+
+QJsonObject Replay::Compare(const QJsonObject &report)
+{
+    QString file;
+    for(auto &arg : QCoreApplication::arguments())
+        if(arg.startsWith("--replay-baseline="))
+            file = arg.section('=', 1);
+    if(file == QString())
+        return QJsonObject();
+    // the baseline is an earlier run's output; its report is the "replay" line
+    QJsonObject baseline;
+    QFile f(file);
+    if(f.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        QTextStream in(&f);
+        while(!in.atEnd() && baseline.isEmpty())
+            baseline = QJsonDocument::fromJson(in.readLine().toUtf8()).object()["replay"].toObject();
+    }
+    if(baseline.isEmpty())
+    {
+        baka->PrintLn(tr("no replay report in %0").arg(file), "replay");
+        return QJsonObject();
+    }
+    auto metric = [](double before, double now)
+    {
+        QJsonObject m;
+        m["baseline"] = before;
+        m["now"] = now;
+        m["change_pct"] = before > 0 ? (now-before)/before*100 : 0;
+        return m;
+    };
+    QJsonObject compare;
+    compare["seconds"] = metric(baseline["seconds"].toDouble(), report["seconds"].toDouble());
+    for(QString stat : {"latency_ms", "lag_ms"})
+        for(QString which : {"median", "p99", "max"})
+            compare[stat+"."+which] = metric(baseline[stat].toObject()[which].toDouble(),
+                                             report[stat].toObject()[which].toDouble());
+    return compare;
+}
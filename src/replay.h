@@ -0,0 +1,46 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QJsonObject>
+
+class BakaEngine;
+
+// --replay=<recording>: plays a --record file back against the fake mpv (see fakempv.h), with
+//  the commands and key presses that went into it, and reports how the player kept up as a
+//  json line on stdout when it's over: wall time, event loop latency, and how late the
+//  recorded input got handled. --replay-baseline=<file> compares against an earlier report.
+class Replay : public QObject
+{
+    Q_OBJECT
+public:
+    static QString Requested();  // the recording from --replay=<file>, if any
+    static qint64 Clock();       // microseconds; the stamp the fake mpv puts on replayed input
+
+    explicit Replay(QObject *parent = 0);
+
+private slots:
+    void ClientMessage(const QStringList &args);
+    void Sample();
+    void Finish();
+
+private:
+    QJsonObject Compare(const QJsonObject &report);
+
+    BakaEngine *baka;
+    QElapsedTimer clock;
+    QTimer *sampler;
+    qint64 lastSample;
+    QVector<double> latency,    // ms the event loop was late for each sample
+                    lag;        // ms from the input going out to it being handled
+    int commands,
+        keys;
+    bool finished;
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,305 @@
+#include "script.h"
+
+#include <QFile>
+#include <QTextStream>
+#include <QRegularExpression>
+
+#include "bakaengine.h"
+#include "mpvhandler.h"
+#include "ui/mainwindow.h"
+
+#define SCRIPT_BATCH 64 // lines run per pass of the event loop
+
+// events wait-for knows, by the play state they come with; the first three are also
+//  states (already being in one counts). playlist-end comes from the window instead
+static const QHash<QString, int> script_events = {
+    {"idle",            Mpv::Idle},
+    {"playing",         Mpv::Playing},
+    {"paused",          Mpv::Paused},
+    {"file-loaded",     Mpv::Started},
+    {"end-file",        Mpv::Stopped},
+    {"playlist-end",    0}
+};
+
+Script::Script(QString file, QObject *parent):
+    QObject(parent),
+    baka(static_cast<BakaEngine*>(parent)),
+    file(file),
+    timer(new QTimer(this)),
+    pc(0)
+{
+    timer->setSingleShot(true);
+    connect(timer, &QTimer::timeout,
+            this, &Script::Timeout);
+    connect(baka->mpv, &MpvHandler::playStateChanged,
+            this, &Script::PlayStateChanged);
+    connect(baka->window, &MainWindow::playlistFinished,
+            this, [=]
+            {
+                Event("playlist-end");
+            });
+}
+
+bool Script::Load()
+{
+    QFile f(file);
+    if(!f.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        emit messageSignal(tr("couldn't open %0").arg(file));
+        return false;
+    }
+    QTextStream in(&f);
+    in.setCodec("UTF-8");
+    QList<int> open; // repeat/for lines waiting for their end
+    for(int number = 1; !in.atEnd(); ++number)
+    {
+        QString text = in.readLine().trimmed();
+        if(text == QString() || text.startsWith('#'))
+            continue;
+        QString keyword = text.section(' ', 0, 0),
+                rest = text.section(' ', 1).trimmed();
+        Line line{Command, QString(), text, -1, number};
+        if(keyword == "set" || keyword == "for")
+        {
+            line.type = keyword == "set" ? Set : For;
+            line.name = rest.section(' ', 0, 0);
+            line.text = rest.section(' ', 1).trimmed();
+            if(line.type == For)
+            {
+                if(line.text.section(' ', 0, 0) != "in")
+                {
+                    emit messageSignal(tr("%0:%1: expected 'for <name> in <items...>'").arg(file, QString::number(number)));
+                    return false;
+                }
+                line.text = line.text.section(' ', 1).trimmed();
+            }
+            if(line.name == QString())
+            {
+                emit messageSignal(tr("%0:%1: '%2' requires a name").arg(file, QString::number(number), keyword));
+                return false;
+            }
+        }
+        else if(keyword == "echo")
+        {
+            line.type = Echo;
+            line.text = rest;
+        }
+        else if(keyword == "sleep" || keyword == "wait-for" || keyword == "repeat")
+        {
+            line.type = keyword == "sleep" ? Sleep : keyword == "repeat" ? Repeat : WaitFor;
+            line.text = rest;
+            if(line.type == WaitFor && !script_events.contains(rest.section(' ', 0, 0)))
+            {
+                emit messageSignal(tr("%0:%1: can't wait for '%2' (%3)").arg(file, QString::number(number), rest, QStringList(script_events.keys()).join(", ")));
+                return false;
+            }
+            // a timeout from a variable is checked once it's expanded
+            QString timeout = rest.section(' ', 1).trimmed();
+            bool ok = true;
+            if(line.type == WaitFor && timeout != QString() && !timeout.contains('$') &&
+               (timeout.toDouble(&ok) < 0 || !ok))
+            {
+                emit messageSignal(tr("%0:%1: invalid timeout '%2'").arg(file, QString::number(number), timeout));
+                return false;
+            }
+        }
+        else if(keyword == "end")
+        {
+            if(open.isEmpty())
+            {
+                emit messageSignal(tr("%0:%1: 'end' without 'repeat' or 'for'").arg(file, QString::number(number)));
+                return false;
+            }
+            line.type = End;
+            line.jump = open.takeLast();
+            lines[line.jump].jump = lines.length()+1;
+        }
+        if(line.type == Repeat || line.type == For)
+            open.append(lines.length());
+        lines.append(line);
+    }
+    if(!open.isEmpty())
+    {
+        emit messageSignal(tr("%0:%1: missing 'end'").arg(file, QString::number(lines[open.last()].number)));
+        return false;
+    }
+    return true;
+}
+
+void Script::Start()
+{
+    QMetaObject::invokeMethod(this, "Step", Qt::QueuedConnection);
+}
+
+void Script::Step()
+{
+    for(int budget = SCRIPT_BATCH; pc < lines.length(); ++pc)
+    {
+        if(budget-- == 0)
+        {
+            // let the gui (and mpv's events) through before going on
+            QMetaObject::invokeMethod(this, "Step", Qt::QueuedConnection);
+            return;
+        }
+        const Line &line = lines[pc];
+        switch(line.type)
+        {
+        case Command:
+            seen.clear(); // waits after this are for what this command causes
+            baka->Command(Expand(line.text));
+            break;
+        case Set:
+            variables[line.name] = Expand(line.text);
+            break;
+        case Echo:
+            emit messageSignal(Expand(line.text));
+            break;
+        case Sleep:
+        {
+            bool ok;
+            double seconds = Expand(line.text).toDouble(&ok);
+            if(!ok || seconds < 0)
+            {
+                Error(line, tr("invalid time '%0'").arg(line.text));
+                return;
+            }
+            ++pc;
+            timer->start(int(seconds*1000));
+            return;
+        }
+        case WaitFor:
+        {
+            QString expanded = Expand(line.text),
+                    event = expanded.section(' ', 0, 0),
+                    timeout = expanded.section(' ', 1).trimmed();
+            double seconds = 0;
+            if(timeout != QString())
+            {
+                bool ok;
+                seconds = timeout.toDouble(&ok);
+                if(!ok || seconds < 0)
+                {
+                    Error(line, tr("invalid timeout '%0'").arg(timeout));
+                    return;
+                }
+            }
+            if(Satisfied(event))
+                break;
+            waiting = event;
+            if(timeout != QString())
+                timer->start(int(seconds*1000));
+            return; // PlayStateChanged picks it up
+        }
+        case Repeat:
+        {
+            bool ok;
+            int count = Expand(line.text).toInt(&ok);
+            if(!ok)
+            {
+                Error(line, tr("invalid count '%0'").arg(line.text));
+                return;
+            }
+            if(count <= 0)
+            {
+                pc = line.jump-1; // skip the body
+                break;
+            }
+            loops.append({pc, count, QStringList(), QString()});
+            break;
+        }
+        case For:
+        {
+            QStringList items = Expand(line.text).split(' ', QString::SkipEmptyParts);
+            if(items.isEmpty())
+            {
+                pc = line.jump-1;
+                break;
+            }
+            variables[line.name] = items.front();
+            loops.append({pc, items.length(), items, line.name});
+            break;
+        }
+        case End:
+        {
+            Loop &loop = loops.last();
+            if(--loop.remaining > 0)
+            {
+                if(loop.name != QString())
+                    variables[loop.name] = loop.items[loop.items.length()-loop.remaining];
+                pc = loop.start; // the body starts after it
+            }
+            else
+                loops.removeLast();
+            break;
+        }
+        }
+    }
+    deleteLater();
+}
+
+void Script::PlayStateChanged(Mpv::PlayState playState)
+{
+    for(auto event = script_events.begin(); event != script_events.end(); ++event)
+        if(*event == playState)
+            Event(event.key());
+}
+
+void Script::Event(QString event)
+{
+    seen.insert(event);
+    if(waiting != QString() && Satisfied(waiting))
+    {
+        waiting = QString();
+        timer->stop();
+        ++pc;
+        // we're inside someone's signal; carry on from the loop instead
+        QMetaObject::invokeMethod(this, "Step", Qt::QueuedConnection);
+    }
+}
+
+void Script::Timeout()
+{
+    if(waiting == QString()) // sleep's over
+    {
+        Step();
+        return;
+    }
+    Error(lines[pc], tr("timed out waiting for '%0'").arg(waiting));
+}
+
+QString Script::Expand(QString text)
+{
+    // $name or ${name}; unknown names expand to nothing
+    static const QRegularExpression variable("\\$(?:\\{(\\w+)\\}|(\\w+))");
+    QString expanded;
+    int last = 0;
+    auto matches = variable.globalMatch(text);
+    while(matches.hasNext())
+    {
+        QRegularExpressionMatch match = matches.next();
+        expanded += text.midRef(last, match.capturedStart()-last);
+        expanded += variables.value(match.captured(1) != QString() ? match.captured(1) : match.captured(2));
+        last = match.capturedEnd();
+    }
+    expanded += text.midRef(last);
+    return expanded;
+}
+
+bool Script::Satisfied(QString event)
+{
+    if(seen.contains(event))
+        return true;
+    // states count if we're already in them
+    Mpv::PlayState playState = baka->mpv->getPlayState();
+    if(event == "idle")
+        return playState == Mpv::Idle || playState == Mpv::Stopped;
+    if(event == "playing" || event == "paused")
+        return playState == script_events[event];
+    return false;
+}
+
+void Script::Error(const Line &line, QString msg)
+{
+    emit messageSignal(tr("%0:%1: %2; stopping").arg(file, QString::number(line.number), msg));
+    deleteLater();
+}
@@ -0,0 +1,71 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QList>
+#include <QHash>
+#include <QSet>
+#include <QTimer>
+
+#include "mpvtypes.h"
+
+class BakaEngine;
+
+// a file of baka/mpv commands run by `baka source` or --script=<file>.
+// it runs a few lines per pass of the event loop; waits and sleeps just return to the loop
+//  and pick up again from a signal or a timer, so the player never blocks on a script.
+// see DOCS/commands.md for the language.
+class Script : public QObject
+{
+    Q_OBJECT
+public:
+    explicit Script(QString file, QObject *parent = 0);
+
+    bool Load();    // parses the file; false (and messageSignal) if it can't be run
+    void Start();   // deletes itself once it's done
+
+signals:
+    void messageSignal(QString msg);
+
+private slots:
+    void Step();
+    void PlayStateChanged(Mpv::PlayState playState);
+    void Event(QString event);
+    void Timeout();
+
+private:
+    enum Type { Command, Set, Echo, Sleep, WaitFor, Repeat, For, End };
+    struct Line
+    {
+        Type type;
+        QString name,   // set/for variable
+                text;   // the rest of the line, expanded when it's run
+        int jump,       // repeat/for: the line after their end; end: its repeat/for
+            number;     // in the file, for messages
+    };
+    struct Loop
+    {
+        int start,      // the repeat/for line
+            remaining;
+        QStringList items;
+        QString name;
+    };
+
+    QString Expand(QString text);
+    bool Satisfied(QString event);
+    void Error(const Line &line, QString msg);
+
+    BakaEngine *baka;
+    QString file;
+    QList<Line> lines;
+    QList<Loop> loops;
+    QHash<QString, QString> variables;
+    QSet<QString> seen;     // events since the last command
+    QString waiting;        // event we're waiting for, if any
+    QTimer *timer;          // sleep, or wait-for timeout
+    int pc;
+};
+
+#endif // SCRIPT_H
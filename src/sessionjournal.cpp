@@ -0,0 +1,182 @@
+#include "sessionjournal.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDataStream>
+
+#include "bakaengine.h"
+#include "mpvhandler.h"
+#include "watchhistory.h"
+
+#define JOURNAL_MAGIC 0x424b534a // "BKSJ"
+#define JOURNAL_VERSION 1
+#define JOURNAL_MAX_SIZE 64*1024 // bytes of appended records before we checkpoint
+#define JOURNAL_TIME_STEP 5      // seconds of playback between time records
+
+// record types
+#define RECORD_PLAYLIST 1   // path, playlist
+#define RECORD_FILE 2       // file
+#define RECORD_TRACKS 3     // vid, aid, sid
+#define RECORD_TIME 4       // time
+
+SessionJournal::SessionJournal(QString file, QObject *parent):
+    QObject(parent),
+    baka(static_cast<BakaEngine*>(parent)),
+    file(file)
+{
+}
+
+SessionJournal::~SessionJournal()
+{
+    setTime(time, true);
+    journal.close();
+}
+
+bool SessionJournal::Restore()
+{
+    if(!Read() || current == QString())
+        return false;
+    // the history would otherwise resume from wherever it last heard of
+    baka->history->setTime(path+current, time);
+    baka->mpv->Restore(path, playlist, current, time, vid, aid, sid);
+    return true;
+}
+
+void SessionJournal::setPlaylist(QString p, const QStringList &list)
+{
+    if(p == path && list == playlist)
+        return;
+    path = p;
+    playlist = list;
+    Checkpoint(); // everything else is relative to the playlist; start over
+}
+
+void SessionJournal::setFile(QString f)
+{
+    if(f == current)
+        return;
+    current = f;
+    time = journaled = 0;
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out << quint8(RECORD_FILE) << current;
+    Append(record);
+}
+
+void SessionJournal::setTracks(int v, int a, int s)
+{
+    if(v == vid && a == aid && s == sid)
+        return;
+    vid = v;
+    aid = a;
+    sid = s;
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out << quint8(RECORD_TRACKS) << qint32(vid) << qint32(aid) << qint32(sid);
+    Append(record);
+}
+
+void SessionJournal::setTime(int t, bool force)
+{
+    time = t;
+    if(current == QString() || time == journaled ||
+       (!force && qAbs(time-journaled) < JOURNAL_TIME_STEP))
+        return;
+    journaled = time;
+    QByteArray record;
+    QDataStream out(&record, QIODevice::WriteOnly);
+    out << quint8(RECORD_TIME) << qint32(time);
+    Append(record);
+}
+
+bool SessionJournal::Read()
+{
+    QFile f(file);
+    if(!f.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&f);
+    quint32 magic, version;
+    in >> magic >> version;
+    if(magic != JOURNAL_MAGIC || version != JOURNAL_VERSION)
+        return false;
+    // replay the records; a crash can only have cut the last one short
+    while(!in.atEnd())
+    {
+        quint8 type;
+        in >> type;
+        QString p, c;
+        QStringList l;
+        qint32 v, a, s, t;
+        switch(type)
+        {
+        case RECORD_PLAYLIST:
+            in >> p >> l;
+            if(in.status() == QDataStream::Ok)
+            {
+                path = p;
+                playlist = l;
+            }
+            break;
+        case RECORD_FILE:
+            in >> c;
+            if(in.status() == QDataStream::Ok)
+            {
+                current = c;
+                time = 0;
+            }
+            break;
+        case RECORD_TRACKS:
+            in >> v >> a >> s;
+            if(in.status() == QDataStream::Ok)
+            {
+                vid = v;
+                aid = a;
+                sid = s;
+            }
+            break;
+        case RECORD_TIME:
+            in >> t;
+            if(in.status() == QDataStream::Ok)
+                time = t;
+            break;
+        default:
+            in.setStatus(QDataStream::ReadCorruptData);
+        }
+        if(in.status() != QDataStream::Ok)
+            break;
+    }
+    journaled = time;
+    return true;
+}
+
+void SessionJournal::Checkpoint()
+{
+    journal.close();
+    QDir().mkpath(QFileInfo(file).absolutePath());
+    QSaveFile f(file);
+    if(f.open(QIODevice::WriteOnly))
+    {
+        QDataStream out(&f);
+        out << quint32(JOURNAL_MAGIC) << quint32(JOURNAL_VERSION)
+            << quint8(RECORD_PLAYLIST) << path << playlist
+            << quint8(RECORD_FILE) << current
+            << quint8(RECORD_TRACKS) << qint32(vid) << qint32(aid) << qint32(sid)
+            << quint8(RECORD_TIME) << qint32(time);
+        f.commit();
+    }
+    journaled = time;
+    journal.setFileName(file);
+    journal.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void SessionJournal::Append(const QByteArray &record)
+{
+    if(!journal.isOpen() || journal.size() > JOURNAL_MAX_SIZE)
+    {
+        Checkpoint(); // already includes this record's change
+        return;
+    }
+    journal.write(record);
+    journal.flush();
+}
@@ -0,0 +1,52 @@
+#ifndef SESSIONJOURNAL_H
+#define SESSIONJOURNAL_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QFile>
+
+class BakaEngine;
+
+// checkpoints what's playing to a small journal as it changes so a crashed
+//  session can be picked up again (--restore-session).
+// every change is a tiny appended record; the journal is rewritten from scratch
+//  only when the playlist changes or it has grown too large.
+class SessionJournal : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SessionJournal(QString file, QObject *parent = 0);
+    ~SessionJournal();
+
+    bool Restore(); // false if there's no session to restore
+
+public slots:
+    void setPlaylist(QString path, const QStringList &list);
+    void setFile(QString f);
+    void setTracks(int vid, int aid, int sid);
+    void setTime(int t, bool force = false); // throttled unless forced
+
+protected:
+    bool Read();
+    void Checkpoint();
+    void Append(const QByteArray &record);
+
+private:
+    BakaEngine *baka;
+    QString file;
+    QFile journal;
+
+    // the session as it stands
+    QString path,
+            current;
+    QStringList playlist;
+    int vid = -1,
+        aid = -1,
+        sid = -1,
+        time = 0,
+        journaled = 0; // last time we wrote out
+};
+
+#endif // SESSIONJOURNAL_H
@@ -2,118 +2,294 @@
 
 #include <QTextStream>
 #include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QTimer>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QDataStream>
+#include <QJsonParseError>
+#include <QDir>
+#include <QStandardPaths>
+
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#include <QCborValue>
+#endif
+
+#include "tracing.h"
+
+#define SETTINGS_SAVE_DELAY 2000 // ms changes are coalesced for before they're written
+#define SNAPSHOT_MAGIC 0x424b5353 // "BKSS"
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+#define SNAPSHOT_VERSION 2 // cbor
+#else
+#define SNAPSHOT_VERSION 1 // qt binary json
+#endif
 
 Settings::Settings(QString file, QObject *parent):
-    QObject(parent)
+    QThread(parent),
+    saveTimer(new QTimer(this))
 {
     this->file = file;
+    saveTimer->setSingleShot(true);
+    saveTimer->setInterval(SETTINGS_SAVE_DELAY);
+    connect(saveTimer, &QTimer::timeout,
+            this, &Settings::Write);
 }
 
 Settings::~Settings()
 {
+    Flush();
+    mutex.lock();
+    quit = true;
+    condition.wakeAll();
+    mutex.unlock();
+    wait();
 }
 
 void Settings::Load()
 {
+    BAKA_TRACE("Settings::Load");
+    QElapsedTimer timer;
+    timer.start();
+
     QFile f(file);
-    if(f.open(QIODevice::ReadOnly | QIODevice::Text))
+    if(!f.open(QIODevice::ReadOnly))
+        return;
+    QFileInfo info(f);
+    qint64 size = info.size(),
+           mtime = info.lastModified().toMSecsSinceEpoch();
+
+    // the snapshot is the parsed document from last time; it's only valid for the exact same file
+    if(LoadSnapshot(size, mtime))
+        loadSource = "snapshot";
+    else
     {
-        QString l = f.readLine();
-        f.close();
-        if(l.startsWith("{"))
+        // one open: map the file and sniff the format off the same bytes we parse
+        uchar *map = size > 0 ? f.map(0, size) : nullptr;
+        QByteArray data = map ? QByteArray::fromRawData(reinterpret_cast<const char*>(map), size) : f.readAll();
+        int i = 0;
+        bool ok = true;
+        while(i < data.size() && QChar(data[i]).isSpace())
+            ++i;
+        if(i < data.size() && data[i] == '{')
         {
-            if(f.open(QIODevice::ReadOnly | QIODevice::Text))
-                document = QJsonDocument::fromJson(f.readAll());
+            QJsonParseError error;
+            document = QJsonDocument::fromJson(data, &error);
+            ok = (error.error == QJsonParseError::NoError);
+            loadSource = "json";
         }
         else
-            LoadIni();
+        {
+            LoadIni(data);
+            loadSource = "ini";
+        }
+        if(map)
+            f.unmap(map);
+        if(ok) // a broken file mustn't replace the last good snapshot
+            SaveSnapshot(document, size, mtime);
     }
+    loadTime = timer.nsecsElapsed()/1000;
 }
 
-void Settings::LoadIni()
+bool Settings::LoadSnapshot(qint64 size, qint64 mtime)
 {
-    QFile f(file);
-    if(f.open(QFile::ReadOnly | QIODevice::Text))
+    QFile f(SnapshotFile());
+    if(!f.open(QIODevice::ReadOnly))
+        return false;
+    QDataStream in(&f);
+    quint32 magic, version;
+    QString source;
+    qint64 source_size, source_mtime;
+    QByteArray data;
+    in >> magic >> version >> source >> source_size >> source_mtime;
+    if(magic != SNAPSHOT_MAGIC || version != SNAPSHOT_VERSION ||
+       source != file || source_size != size || source_mtime != mtime)
+        return false;
+    in >> data;
+    if(in.status() != QDataStream::Ok)
+        return false;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    QCborValue value = QCborValue::fromCbor(data);
+    if(!value.isMap())
+        return false;
+    document = QJsonDocument(value.toMap().toJsonObject());
+#else
+    document = QJsonDocument::fromBinaryData(data);
+    if(document.isNull())
+        return false;
+#endif
+    return true;
+}
+
+void Settings::SaveSnapshot(const QJsonDocument &doc, qint64 size, qint64 mtime)
+{
+    QString snapshot = SnapshotFile();
+    QDir().mkpath(QFileInfo(snapshot).absolutePath());
+    QSaveFile f(snapshot);
+    if(!f.open(QIODevice::WriteOnly))
+        return;
+    QDataStream out(&f);
+    out << quint32(SNAPSHOT_MAGIC) << quint32(SNAPSHOT_VERSION)
+        << file << size << mtime;
+#if QT_VERSION >= QT_VERSION_CHECK(5, 12, 0)
+    out << QCborValue::fromJsonValue(doc.object()).toCbor();
+#else
+    out << doc.toBinaryData();
+#endif
+    f.commit();
+}
+
+QString Settings::SnapshotFile()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::CacheLocation)+"/settings.snapshot";
+}
+
+void Settings::LoadIni(const QByteArray &data)
+{
+    QTextStream fin(data);
+    fin.setCodec("UTF-8");
+    QString line;
+    int i;
+    QString group;
+    QJsonObject group_obj,
+                root = getRoot();
+    do
     {
-        QTextStream fin(&f);
-        fin.setCodec("UTF-8");
-        QString line;
-        int i;
-        QString group;
-        QJsonObject group_obj,
-                    root = getRoot();
-        do
+        line = fin.readLine().trimmed();
+        if(line.startsWith('[') && line.endsWith(']')) // group
         {
-            line = fin.readLine().trimmed();
-            if(line.startsWith('[') && line.endsWith(']')) // group
-            {
-                if(group != QString())
-                    root[group] = group_obj;
-                group = line.mid(1, line.length()-2); // [...] <- get ...
-                group_obj = QJsonObject();
-            }
-            else if((i = ParseLine(line)) != -1) // foo=bar
+            if(group != QString())
+                root[group] = group_obj;
+            group = line.mid(1, line.length()-2); // [...] <- get ...
+            group_obj = QJsonObject();
+        }
+        else if((i = ParseLine(line)) != -1) // foo=bar
+        {
+            QString key = FixKeyOnLoad(line.left(i)),
+                    val = line.mid(i+1);
+            QString number = val.trimmed(); // toInt() skips surrounding whitespace too
+            QJsonValue value(val);
+            if(val == "true" || val == "false")
+                value = QJsonValue(val == "true");
+            else if(number != QString() && (number[0].isDigit() || number[0] == '-' || number[0] == '+')) // only numbers are worth converting
             {
-                QString key = FixKeyOnLoad(line.left(i)),
-                        val = line.mid(i+1);
-                bool    b = (val == "true" || val == "false");
-                bool    iok;
-                int     ival = val.toInt(&iok);
-                bool    dok;
-                double  dval = val.toDouble(&dok);
-                if(group == "baka-mplayer")
-                    root[key] = b ? QJsonValue(val=="true") : (iok ? (dok ? QJsonValue(dval) : QJsonValue(ival)) : QJsonValue(val));
-                else
-                    group_obj[key] = b ? QJsonValue(val=="true") : (iok ? (dok ? QJsonValue(dval) : QJsonValue(ival)) : QJsonValue(val));
+                bool ok;
+                int ival = val.toInt(&ok);
+                if(ok)
+                    value = QJsonValue(ival);
             }
-        } while(!line.isNull());
-        f.close();
+            if(group == "baka-mplayer")
+                root[key] = value;
+            else
+                group_obj[key] = value;
+        }
+    } while(!line.isNull());
 
-        if(group != QString())
-            root[group] = group_obj;
+    if(group != QString())
+        root[group] = group_obj;
 
-        // remove excess baka-mplayer group
-        root.remove("baka-mplayer");
+    // remove excess baka-mplayer group
+    root.remove("baka-mplayer");
 
-        // fix input
-        if(root.find("input") != root.end())
+    // fix input
+    if(root.find("input") != root.end())
+    {
+        QJsonObject input_obj = root["input"].toObject();
+        for(auto in : input_obj)
         {
-            QJsonObject input_obj = root["input"].toObject();
-            for(auto in : input_obj)
-            {
-                QJsonArray opts;
-                for(auto &o : in.toString().split('#'))
-                    opts.append(o.trimmed());
-                in = opts;
-            }
-            root["input"] = input_obj;
+            QJsonArray opts;
+            for(auto &o : in.toString().split('#'))
+                opts.append(o.trimmed());
+            in = opts;
         }
+        root["input"] = input_obj;
+    }
 
-        // fix recent
-        if(root.find("recent") != root.end())
+    // fix recent
+    if(root.find("recent") != root.end())
+    {
+        QStringList recent = SplitQStringList(root["recent"].toString());
+        QJsonArray R;
+        for(auto str : recent)
         {
-            QStringList recent = SplitQStringList(root["recent"].toString());
-            QJsonArray R;
-            for(auto str : recent)
-            {
-                QJsonObject r;
-                r["path"] = str;
-                R.append(r);
-            }
-            root["recent"] = R;
+            QJsonObject r;
+            r["path"] = str;
+            R.append(r);
         }
-
-        setRoot(root);
+        root["recent"] = R;
     }
+
+    setRoot(root);
 }
 
 void Settings::Save()
 {
-    QFile f(file);
-    if(f.open(QFile::WriteOnly | QFile::Truncate | QIODevice::Text))
+    // the window starts with the first change so a steady stream of them can't hold the save off
+    if(!dirty.isEmpty() && !saveTimer->isActive())
+        saveTimer->start();
+}
+
+void Settings::Flush()
+{
+    BAKA_TRACE("Settings::Flush");
+    if(saveTimer->isActive())
     {
-        f.write(document.toJson());
-        f.close();
+        saveTimer->stop();
+        Write();
+    }
+    QMutexLocker lock(&mutex);
+    while(done < queued && isRunning())
+        written.wait(&mutex);
+}
+
+void Settings::Write()
+{
+    dirty.clear();
+    QMutexLocker lock(&mutex);
+    pending = document; // implicitly shared; serializing it is left to the worker
+    ++queued;
+    if(!isRunning())
+        start(QThread::LowPriority);
+    condition.wakeAll();
+}
+
+void Settings::run()
+{
+    forever
+    {
+        mutex.lock();
+        while(!quit && done == queued)
+            condition.wait(&mutex);
+        if(done == queued) // quit with nothing left to write
+        {
+            mutex.unlock();
+            break;
+        }
+        QJsonDocument doc = pending;
+        int target = queued;
+        mutex.unlock();
+
+        BAKA_TRACE("Settings::write");
+
+        // QSaveFile writes to a temporary and renames it over the old file on commit,
+        //  so a crash mid-write leaves the previous settings intact
+        QSaveFile f(file);
+        if(!f.open(QFile::WriteOnly | QIODevice::Text) ||
+           f.write(doc.toJson()) == -1 ||
+           !f.commit())
+            emit messageSignal(tr("failed to save settings: %0").arg(f.errorString())+"\n");
+        else
+        {
+            // keep the snapshot in step so the next start can skip parsing
+            QFileInfo info(file);
+            SaveSnapshot(doc, info.size(), info.lastModified().toMSecsSinceEpoch());
+        }
+
+        mutex.lock();
+        done = target;
+        written.wakeAll();
+        mutex.unlock();
     }
 }
 
@@ -124,6 +300,13 @@ QJsonObject Settings::getRoot()
 
 void Settings::setRoot(QJsonObject root)
 {
+    QJsonObject old = document.object();
+    for(auto i = root.begin(); i != root.end(); ++i)
+        if(old.value(i.key()) != i.value())
+            dirty.insert(i.key());
+    for(auto i = old.begin(); i != old.end(); ++i)
+        if(!root.contains(i.key()))
+            dirty.insert(i.key());
     document.setObject(root);
 }
 
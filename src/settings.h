@@ -1,8 +1,11 @@
 #ifndef SETTINGS_H
 #define SETTINGS_H
 
-#include <QObject>
+#include <QThread>
 #include <QMap>
+#include <QSet>
+#include <QMutex>
+#include <QWaitCondition>
 #include <QString>
 #include <QStringList>
 #include <QDate>
@@ -12,31 +15,62 @@
 #include <QJsonValue>
 
 class BakaEngine;
+class QTimer;
 
-class Settings : public QObject
+// the settings document; saves are coalesced and written by a worker thread
+class Settings : public QThread
 {
     Q_OBJECT
 public:
     explicit Settings(QString file, QObject *parent = 0);
-    ~Settings();
+    ~Settings(); // flushes any pending save
 
 public slots:
     void Load();
-    void Save();
+    void Save();    // schedules a save if anything changed since the last one
+    void Flush();   // writes a scheduled save now and waits until it's on disk
 
     QJsonObject getRoot();
-    void setRoot(QJsonObject);
+    void setRoot(QJsonObject); // marks the top-level keys that changed as dirty
+
+    qint64 getLoadTime()        { return loadTime; }    // microseconds the last Load() took
+    QString getLoadSource()     { return loadSource; }  // "snapshot", "json" or "ini"
+
+signals:
+    void messageSignal(QString m);
 
 protected:
-    void LoadIni();
+    void run();
+
+    bool LoadSnapshot(qint64 size, qint64 mtime);
+    void SaveSnapshot(const QJsonDocument &doc, qint64 size, qint64 mtime);
+    QString SnapshotFile();
+
+    void LoadIni(const QByteArray &data);
     int ParseLine(QString line);
     QString FixKeyOnLoad(QString key);
     QStringList SplitQStringList(QString list);
 
+protected slots:
+    void Write(); // hands the document over to the worker
+
 private:
     BakaEngine *baka;
     QJsonDocument document;
     QString file;
+    QSet<QString> dirty;    // top-level keys changed since the last save
+    QTimer *saveTimer;
+    qint64 loadTime = 0;
+    QString loadSource;
+
+    // shared with the worker thread, guarded by mutex
+    QMutex mutex;
+    QWaitCondition condition,
+                   written;
+    QJsonDocument pending;
+    int queued = 0,     // saves handed to the worker
+        done = 0;       // saves the worker has finished
+    bool quit = false;
 };
 
 #endif // SETTINGS_H
@@ -0,0 +1,215 @@
+#include "singleinstance.h"
+
+#include <QCoreApplication>
+#include <QLocalServer>
+#include <QLocalSocket>
+#include <QFileInfo>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include "bakaengine.h"
+#include "mpvhandler.h"
+#include "ui/mainwindow.h"
+#include "util.h"
+
+#if !defined(Q_OS_WIN)
+#include <sys/stat.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+#define INSTANCE_TIMEOUT 2000 // ms we give the running player to answer before starting our own
+
+// one server per user. on windows this is a named pipe that only the user can open (see Listen);
+//  on unix a socket in the user's runtime dir, or failing that in a directory of the temp dir
+//  that only the user can get into. empty if there's no such place
+static QString ServerName()
+{
+#if defined(Q_OS_WIN)
+    return QString("baka-mplayer-%0").arg(QString::fromLocal8Bit(qgetenv("USERNAME")));
+#else
+    QString runtime = QString::fromLocal8Bit(qgetenv("XDG_RUNTIME_DIR"));
+    if(runtime != QString() && QFileInfo(runtime).isDir())
+        return runtime+"/baka-mplayer.sock";
+
+    // the temp dir is shared; a directory someone else made (or left open) for us isn't ours
+    QString dir = QString("%0/baka-mplayer-%1").arg(QDir::tempPath(), QString::number(getuid()));
+    if(mkdir(dir.toLocal8Bit().constData(), 0700) != 0 && errno != EEXIST)
+        return QString();
+    struct stat info;
+    if(lstat(dir.toLocal8Bit().constData(), &info) != 0 ||
+       !S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 077) != 0)
+        return QString();
+    return dir+"/instance.sock";
+#endif
+}
+
+// 1 for --single-instance, 0 for --new-instance (and benchmark/headless runs), -1 to go by the setting
+static int Requested(const QStringList &args)
+{
+    if(args.contains("--new-instance") || args.contains("--benchmark-startup-run") || args.contains("--headless"))
+        return 0;
+    for(auto &arg : args)
+        if(arg.startsWith("--fake-mpv=") || arg.startsWith("--replay="))
+            return 0;
+    if(args.contains("--single-instance"))
+        return 1;
+    return -1;
+}
+
+SingleInstance::SingleInstance(QObject *parent):
+    QObject(parent),
+    baka(static_cast<BakaEngine*>(parent)),
+    server(nullptr),
+    enabled(false),
+    started(false)
+{
+}
+
+SingleInstance::~SingleInstance()
+{
+    if(server != nullptr)
+        delete server;
+}
+
+bool SingleInstance::Forward(QStringList args)
+{
+    if(Requested(args) == 0)
+        return false;
+
+    // same rules as main: flags aside, the first argument is the file
+    QString file;
+    for(auto arg = args.begin()+1; arg != args.end(); ++arg)
+    {
+        if(!arg->startsWith("--"))
+        {
+            file = *arg;
+            break;
+        }
+    }
+    if(file == "-") // stdin is ours; it can't be handed over
+        return false;
+
+    QString name = ServerName();
+    if(name == QString())
+        return false;
+    QLocalSocket socket;
+    socket.connectToServer(name);
+    if(!socket.waitForConnected(INSTANCE_TIMEOUT))
+        return false; // nobody's listening; we're the first
+
+    QJsonObject request;
+    if(file == QString())
+        request["action"] = "raise";
+    else
+    {
+        request["action"] = "open";
+        // the running player has its own working directory
+        request["file"] = Util::IsValidUrl(file) ? file : QFileInfo(file).absoluteFilePath();
+    }
+    socket.write(QJsonDocument(request).toJson(QJsonDocument::Compact)+"\n");
+    if(!socket.waitForBytesWritten(INSTANCE_TIMEOUT))
+        return false;
+    // wait for the answer so we only exit once it's actually been taken
+    while(!socket.canReadLine())
+        if(!socket.waitForReadyRead(INSTANCE_TIMEOUT))
+            return false;
+    return socket.readLine().trimmed() == "ok";
+}
+
+void SingleInstance::setEnabled(bool b)
+{
+    enabled = b;
+    if(started)
+        Listen();
+}
+
+void SingleInstance::Start()
+{
+    started = true;
+    Listen();
+}
+
+void SingleInstance::Listen()
+{
+    int requested = Requested(QCoreApplication::arguments());
+    bool listen = requested < 0 ? enabled : requested > 0;
+    if(!listen)
+    {
+        if(server != nullptr)
+        {
+            delete server;
+            server = nullptr;
+        }
+        return;
+    }
+    if(server != nullptr)
+        return;
+
+    QString name = ServerName();
+    if(name == QString())
+    {
+        emit messageSignal(tr("no private place for the instance socket; single-instance mode is off"));
+        return;
+    }
+
+    // another player may already be serving (we were started with --new-instance, or raced it)
+    QLocalSocket probe;
+    probe.connectToServer(name);
+    if(probe.waitForConnected(100))
+        return;
+
+    server = new QLocalServer(this);
+    server->setSocketOptions(QLocalServer::UserAccessOption);
+    connect(server, &QLocalServer::newConnection,
+            this, &SingleInstance::Accept);
+    if(!server->listen(name))
+    {
+        // nobody answered, so whatever is there was left behind by a crash
+        QLocalServer::removeServer(name);
+        if(!server->listen(name))
+        {
+            emit messageSignal(server->errorString());
+            delete server;
+            server = nullptr;
+        }
+    }
+}
+
+void SingleInstance::Accept()
+{
+    while(QLocalSocket *socket = server->nextPendingConnection())
+    {
+        connect(socket, &QLocalSocket::readyRead,
+                [=]
+                {
+                    Read(socket);
+                });
+        connect(socket, &QLocalSocket::disconnected,
+                socket, &QLocalSocket::deleteLater);
+        Read(socket); // the request may have come in with the connection
+    }
+}
+
+void SingleInstance::Read(QLocalSocket *socket)
+{
+    if(!socket->canReadLine())
+        return;
+    QJsonObject request = QJsonDocument::fromJson(socket->readLine()).object();
+    QString action = request["action"].toString();
+    if(action == "open" || action == "raise")
+    {
+        MainWindow *window = baka->window;
+        window->setWindowState(window->windowState() & ~Qt::WindowMinimized);
+        window->show();
+        window->raise();
+        window->activateWindow();
+        if(action == "open")
+            baka->mpv->LoadFile(request["file"].toString());
+        socket->write("ok\n");
+    }
+    else
+        socket->write("error\n");
+    socket->disconnectFromServer();
+}
@@ -0,0 +1,48 @@
+#ifndef SINGLEINSTANCE_H
+#define SINGLEINSTANCE_H
+
+#include <QObject>
+#include <QString>
+#include <QStringList>
+
+class BakaEngine;
+class QLocalServer;
+class QLocalSocket;
+
+// single-instance mode: the first player listens on a local socket and later launches hand
+//  it their file and exit instead of starting up a player of their own.
+// --single-instance / --new-instance override the setting for one launch.
+class SingleInstance : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SingleInstance(QObject *parent = 0);
+    ~SingleInstance();
+
+    // client side; call it once the application object is up, before any window is.
+    //  true if a running player took the arguments and we should exit
+    static bool Forward(QStringList args);
+
+    bool getEnabled() { return enabled; }
+
+public slots:
+    void setEnabled(bool b);
+    void Start(); // mpv is up; we can take files from now on
+
+signals:
+    void messageSignal(QString msg);
+
+private slots:
+    void Accept();
+
+private:
+    void Listen();
+    void Read(QLocalSocket *socket);
+
+    BakaEngine *baka;
+    QLocalServer *server;
+    bool enabled,
+         started;
+};
+
+#endif // SINGLEINSTANCE_H
@@ -0,0 +1,330 @@
+#include "thumbnailhandler.h"
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QPair>
+#include <QHash>
+#include <QStandardPaths>
+#include <QMutexLocker>
+
+#include <algorithm> // for std::max, std::sort
+
+#include "util.h"
+
+#define THUMBNAIL_WIDTH 160
+#define THUMBNAIL_BUCKETS 200   // previews per file; determines the time granularity
+#define THUMBNAIL_PREFETCH 2    // neighbouring buckets decoded on each side of a request
+#define THUMBNAIL_CACHE 256     // in-memory lru size (images)
+#define THUMBNAIL_TIMEOUT 5     // seconds we wait on the worker mpv before giving up
+#define THUMBNAIL_DISK_CACHE 256*1024*1024 // bytes on disk, over all files, before the least recently opened go
+
+ThumbnailHandler::ThumbnailHandler(QObject *parent):
+    QThread(parent),
+    cache(THUMBNAIL_CACHE)
+{
+    connect(this, &ThumbnailHandler::decoded,
+            this, &ThumbnailHandler::Insert,
+            Qt::QueuedConnection);
+}
+
+ThumbnailHandler::~ThumbnailHandler()
+{
+    mutex.lock();
+    quit = true;
+    if(worker_mpv)
+        mpv_wakeup(worker_mpv); // interrupt WaitFor
+    condition.wakeAll();
+    mutex.unlock();
+    wait();
+}
+
+void ThumbnailHandler::setEnabled(bool b)
+{
+    enabled = b;
+    if(!b)
+        setFile(QString(), 0);
+}
+
+void ThumbnailHandler::setFile(QString f, int length)
+{
+    if(!enabled)
+        f = QString();
+
+    QMutexLocker lock(&mutex);
+    if(f == file)
+        return;
+    file = f;
+    ++generation;
+    bucketSize = std::max(1, length / THUMBNAIL_BUCKETS);
+    buckets = length / bucketSize + 1;
+    pending = -1;
+    prefetch.clear();
+    cache.clear();
+    wanted = -1;
+    if(file != QString() && !isRunning()) // the worker is only started once it's needed
+        start(QThread::LowPriority);
+    condition.wakeAll();
+}
+
+void ThumbnailHandler::request(int time)
+{
+    if(!enabled)
+        return;
+
+    QImage image;
+    mutex.lock();
+    if(file == QString())
+    {
+        mutex.unlock();
+        return;
+    }
+    int b = time / bucketSize;
+    if(b == wanted)
+    {
+        mutex.unlock();
+        return;
+    }
+    wanted = b;
+
+    if(cache.contains(b))
+        image = *cache.object(b);
+    else
+        pending = b; // replaces whatever was requested before
+
+    // replace the prefetch queue with the neighbourhood of the new position
+    prefetch.clear();
+    for(int i = 1; i <= THUMBNAIL_PREFETCH; ++i)
+    {
+        for(int n : {b+i, b-i})
+            if(n >= 0 && n < buckets && !cache.contains(n))
+                prefetch.append(n);
+    }
+    condition.wakeAll();
+    mutex.unlock();
+
+    if(!image.isNull())
+        emit thumbnailChanged(image);
+}
+
+void ThumbnailHandler::Insert(int gen, int bucket, const QImage &image)
+{
+    mutex.lock();
+    bool stale = (gen != generation);
+    mutex.unlock();
+    if(stale) // the file changed while this was being decoded
+        return;
+    cache.insert(bucket, new QImage(image));
+    if(bucket == wanted)
+        emit thumbnailChanged(image);
+}
+
+void ThumbnailHandler::run()
+{
+    mpv_handle *handle = mpv_create();
+    if(!handle)
+        return;
+
+    // headless, silent, as cheap as possible
+    mpv_set_option_string(handle, "vo", "null");
+    mpv_set_option_string(handle, "ao", "null");
+    mpv_set_option_string(handle, "aid", "no");
+    mpv_set_option_string(handle, "sid", "no");
+    mpv_set_option_string(handle, "pause", "yes");
+    mpv_set_option_string(handle, "keep-open", "yes");
+    mpv_set_option_string(handle, "hr-seek", "no");
+    mpv_set_option_string(handle, "hwdec", "no");
+    mpv_set_option_string(handle, "ytdl", "no");
+    mpv_set_option_string(handle, "load-scripts", "no");
+    mpv_set_option_string(handle, "sub-auto", "no");
+    mpv_set_option_string(handle, "vd-lavc-skiploopfilter", "all");
+    mpv_set_option_string(handle, "vd-lavc-fast", "yes");
+    if(mpv_initialize(handle) < 0)
+    {
+        mpv_terminate_destroy(handle);
+        return;
+    }
+
+    mutex.lock();
+    worker_mpv = handle;
+    mutex.unlock();
+
+    int loaded = -1; // generation of the file loaded in the worker
+    QString key;
+    bool ok = false;
+    forever
+    {
+        mutex.lock();
+        while(!quit && loaded == generation && (!ok || (pending == -1 && prefetch.empty())))
+            condition.wait(&mutex);
+        if(quit)
+        {
+            mutex.unlock();
+            break;
+        }
+        if(loaded != generation)
+        {
+            QString f = file;
+            loaded = generation;
+            mutex.unlock();
+
+            ok = false;
+            if(f == QString())
+            {
+                const char *args[] = {"stop", NULL};
+                mpv_command(handle, args);
+            }
+            else
+            {
+                key = Util::FileIdentity(f);
+                QString dir = CacheFile(key, 0).section('/', 0, -2);
+                QDir().mkpath(dir);
+                QFile used(dir+"/.used"); // its mtime is when the file was last opened
+                used.open(QIODevice::WriteOnly | QIODevice::Truncate);
+                used.close();
+                Prune(key);
+                const QByteArray tmp = f.toUtf8();
+                const char *args[] = {"loadfile", tmp.constData(), NULL};
+                ok = mpv_command(handle, args) >= 0 &&
+                     WaitFor(handle, MPV_EVENT_FILE_LOADED, THUMBNAIL_TIMEOUT) &&
+                     WaitFor(handle, MPV_EVENT_PLAYBACK_RESTART, THUMBNAIL_TIMEOUT); // first frame is up
+            }
+            continue;
+        }
+
+        int b, gen = generation, size = bucketSize;
+        if(pending != -1)
+        {
+            b = pending;
+            pending = -1;
+        }
+        else
+            b = prefetch.takeFirst();
+        mutex.unlock();
+
+        // the disk cache survives restarts; only decode what isn't on it
+        QString cached = CacheFile(key, b);
+        QImage image(cached);
+        if(image.isNull())
+        {
+            image = Grab(handle, b*size);
+            if(!image.isNull())
+                image.save(cached, "JPG", 80);
+        }
+        if(!image.isNull())
+            emit decoded(gen, b, image);
+    }
+
+    mutex.lock();
+    worker_mpv = nullptr;
+    mutex.unlock();
+    mpv_terminate_destroy(handle);
+}
+
+QImage ThumbnailHandler::Grab(mpv_handle *handle, int time)
+{
+    const QByteArray tmp = QString::number(time).toUtf8();
+    const char *seek[] = {"seek", tmp.constData(), "absolute+keyframes", NULL};
+    if(mpv_command(handle, seek) < 0 ||
+       !WaitFor(handle, MPV_EVENT_PLAYBACK_RESTART, THUMBNAIL_TIMEOUT))
+        return QImage();
+
+    const char *screenshot[] = {"screenshot-raw", "video", NULL};
+    mpv_node node;
+    if(mpv_command_ret(handle, screenshot, &node) < 0)
+        return QImage();
+
+    QImage image;
+    if(node.format == MPV_FORMAT_NODE_MAP)
+    {
+        int w = 0, h = 0, stride = 0;
+        QString format;
+        mpv_byte_array *data = nullptr;
+        for(int n = 0; n < node.u.list->num; n++)
+        {
+            QString k = node.u.list->keys[n];
+            mpv_node &v = node.u.list->values[n];
+            if(k == "w" && v.format == MPV_FORMAT_INT64)
+                w = v.u.int64;
+            else if(k == "h" && v.format == MPV_FORMAT_INT64)
+                h = v.u.int64;
+            else if(k == "stride" && v.format == MPV_FORMAT_INT64)
+                stride = v.u.int64;
+            else if(k == "format" && v.format == MPV_FORMAT_STRING)
+                format = v.u.string;
+            else if(k == "data" && v.format == MPV_FORMAT_BYTE_ARRAY)
+                data = v.u.ba;
+        }
+        // bgr0 is laid out the same as QImage's (little endian) RGB32
+        if(w > 0 && h > 0 && data != nullptr && format == "bgr0")
+            image = QImage((const uchar*)data->data, w, h, stride, QImage::Format_RGB32)
+                    .scaledToWidth(THUMBNAIL_WIDTH, Qt::SmoothTransformation); // scaling detaches from mpv's buffer
+    }
+    mpv_free_node_contents(&node);
+    return image;
+}
+
+bool ThumbnailHandler::WaitFor(mpv_handle *handle, mpv_event_id id, double timeout)
+{
+    bool started = false;
+    forever
+    {
+        mpv_event *event = mpv_wait_event(handle, timeout);
+        if(event->event_id == id)
+            return true;
+        switch(event->event_id)
+        {
+        case MPV_EVENT_START_FILE:
+            started = true;
+            break;
+        case MPV_EVENT_END_FILE:
+            // loading a new file ends the previous one first; that one doesn't count
+            if(started || id != MPV_EVENT_FILE_LOADED)
+                return false;
+            break;
+        case MPV_EVENT_NONE: // timed out or woken up to quit
+        case MPV_EVENT_SHUTDOWN:
+            return false;
+        default:
+            break;
+        }
+    }
+}
+
+void ThumbnailHandler::Prune(QString keep)
+{
+    // whole files go, least recently opened first, until the rest fits
+    QDir root(CacheFile(QString(), 0).section('/', 0, -3));
+    QList<QPair<QDateTime, QString>> dirs;
+    QHash<QString, qint64> sizes;
+    qint64 total = 0;
+    for(auto &dir : root.entryInfoList(QDir::Dirs | QDir::NoDotAndDotDot))
+    {
+        qint64 size = 0;
+        for(auto &f : QDir(dir.absoluteFilePath()).entryInfoList(QDir::Files | QDir::Hidden))
+            size += f.size();
+        QFileInfo used(dir.absoluteFilePath()+"/.used");
+        dirs.append({used.exists() ? used.lastModified() : dir.lastModified(), dir.fileName()});
+        sizes[dir.fileName()] = size;
+        total += size;
+    }
+    std::sort(dirs.begin(), dirs.end());
+    for(auto &dir : dirs)
+    {
+        if(total <= THUMBNAIL_DISK_CACHE)
+            break;
+        if(dir.second == keep)
+            continue;
+        if(QDir(root.absoluteFilePath(dir.second)).removeRecursively())
+            total -= sizes[dir.second];
+    }
+}
+
+QString ThumbnailHandler::CacheFile(QString key, int bucket)
+{
+    return QString("%0/thumbnails/%1/%2.jpg").arg(
+                QStandardPaths::writableLocation(QStandardPaths::CacheLocation),
+                key,
+                QString::number(bucket));
+}
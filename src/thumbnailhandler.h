@@ -0,0 +1,63 @@
+#ifndef THUMBNAILHANDLER_H
+#define THUMBNAILHANDLER_H
+
+#include <QThread>
+#include <QString>
+#include <QImage>
+#include <QCache>
+#include <QList>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <mpv/client.h>
+
+class ThumbnailHandler : public QThread
+{
+    Q_OBJECT
+public:
+    explicit ThumbnailHandler(QObject *parent = 0);
+    ~ThumbnailHandler();
+
+    bool getEnabled() { return enabled; }
+
+public slots:
+    void setEnabled(bool b);
+    void setFile(QString f, int length); // empty file disables previews
+    void request(int time);              // coalesced; only the latest request is kept
+
+signals:
+    void thumbnailChanged(const QImage &image);
+    void decoded(int generation, int bucket, const QImage &image); // worker -> gui thread
+
+protected:
+    void run();
+
+    QImage Grab(mpv_handle *handle, int time);
+    bool WaitFor(mpv_handle *handle, mpv_event_id id, double timeout);
+    QString CacheFile(QString key, int bucket);
+    void Prune(QString keep); // caps the disk cache; keep is the file being opened
+
+protected slots:
+    void Insert(int generation, int bucket, const QImage &image);
+
+private:
+    QCache<int, QImage> cache; // in-memory lru of the current file's buckets
+
+    // shared with the worker thread, guarded by mutex
+    QMutex mutex;
+    QWaitCondition condition;
+    mpv_handle *worker_mpv = nullptr;
+    QString file;
+    int generation = 0,
+        bucketSize = 1,
+        buckets = 0,
+        pending = -1;
+    QList<int> prefetch;
+    bool quit = false;
+
+    // gui thread only
+    int wanted = -1;
+    bool enabled = true;
+};
+
+#endif // THUMBNAILHANDLER_H
@@ -0,0 +1,213 @@
+#include "tracing.h"
+
+#include <QCoreApplication>
+#include <QThread>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QList>
+#include <QFile>
+#include <QTextStream>
+
+#include <atomic>
+#include <chrono>
+
+#define TRACE_BUFFER_SIZE 65536 // events per thread per session; the rest are dropped
+
+namespace Tracing {
+
+struct Event
+{
+    const char *name;
+    qint64 start,       // us
+           duration;
+};
+
+// written only by its own thread; count is published with release so a reader
+//  never sees an event that's still being filled in
+struct Buffer
+{
+    Event events[TRACE_BUFFER_SIZE];
+    std::atomic<int> count{0};
+    std::atomic<int> session{0};
+    quint64 tid;
+    QString thread;
+    bool owned = true;  // its thread is still alive (guarded by the registry mutex)
+};
+
+static std::atomic<bool> active{false};
+static std::atomic<int> session{0};
+static QMutex registryMutex;    // only taken the first time a thread records, and when it exits
+static QList<Buffer*> registry; // buffers outlive their threads so they can still be saved;
+                                //  a new thread takes over a released one, Start() frees the rest
+
+// hands the thread's buffer back to the registry when the thread exits
+struct Owner
+{
+    Buffer *buffer = nullptr;
+    ~Owner()
+    {
+        if(buffer == nullptr)
+            return;
+        QMutexLocker lock(&registryMutex);
+        buffer->owned = false;
+    }
+};
+
+static qint64 Now()
+{
+    using namespace std::chrono;
+    static const steady_clock::time_point epoch = steady_clock::now();
+    return duration_cast<microseconds>(steady_clock::now() - epoch).count();
+}
+
+static Buffer *LocalBuffer()
+{
+    static thread_local Owner owner;
+    Buffer *&buffer = owner.buffer;
+    if(buffer == nullptr)
+    {
+        QMutexLocker lock(&registryMutex);
+        const int s = session.load(std::memory_order_acquire);
+        for(Buffer *b : registry) // one that has nothing of this session left to save
+        {
+            if(!b->owned && (b->session.load(std::memory_order_relaxed) != s ||
+                             b->count.load(std::memory_order_relaxed) == 0))
+            {
+                buffer = b;
+                buffer->owned = true;
+                buffer->count.store(0, std::memory_order_relaxed);
+                break;
+            }
+        }
+        if(buffer == nullptr)
+        {
+            buffer = new Buffer;
+            registry.append(buffer);
+        }
+        buffer->tid = quint64(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+        QThread *thread = QThread::currentThread();
+        if(QCoreApplication::instance() && thread == QCoreApplication::instance()->thread())
+            buffer->thread = "gui";
+        else if(thread->objectName() != QString())
+            buffer->thread = thread->objectName();
+        else
+            buffer->thread = thread->metaObject()->className();
+    }
+    return buffer;
+}
+
+static void Record(const char *name, qint64 start, qint64 duration)
+{
+    Buffer *buffer = LocalBuffer();
+    int s = session.load(std::memory_order_acquire);
+    if(buffer->session.load(std::memory_order_relaxed) != s) // first event of a new session; drop the old ones
+    {
+        buffer->count.store(0, std::memory_order_relaxed);
+        buffer->session.store(s, std::memory_order_release);
+    }
+    int i = buffer->count.load(std::memory_order_relaxed);
+    if(i >= TRACE_BUFFER_SIZE)
+        return;
+    buffer->events[i] = {name, start, duration};
+    buffer->count.store(i+1, std::memory_order_release);
+}
+
+bool Supported()
+{
+#if defined(BAKA_TRACING)
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool IsActive()
+{
+    return active.load(std::memory_order_relaxed);
+}
+
+void Start()
+{
+    {
+        // whatever the threads that are gone left behind is about to be stale
+        QMutexLocker lock(&registryMutex);
+        for(auto i = registry.begin(); i != registry.end();)
+        {
+            if((*i)->owned)
+                ++i;
+            else
+            {
+                delete *i;
+                i = registry.erase(i);
+            }
+        }
+    }
+    session.fetch_add(1, std::memory_order_release);
+    active.store(true, std::memory_order_release);
+}
+
+void Stop()
+{
+    active.store(false, std::memory_order_release);
+}
+
+static QString Escape(QString s)
+{
+    return s.replace('\\', "\\\\").replace('"', "\\\"");
+}
+
+int Save(QString file)
+{
+    QFile f(file);
+    if(!f.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Text))
+        return -1;
+    QTextStream out(&f);
+    out.setCodec("UTF-8");
+
+    const qint64 pid = QCoreApplication::applicationPid();
+    const int s = session.load(std::memory_order_acquire);
+    int n = 0;
+    bool first = true;
+    out << "{\"traceEvents\":[\n";
+    QMutexLocker lock(&registryMutex);
+    for(Buffer *buffer : registry)
+    {
+        if(buffer->session.load(std::memory_order_acquire) != s)
+            continue;
+        int count = buffer->count.load(std::memory_order_acquire);
+        out << (first ? "" : ",\n")
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << pid << ",\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"" << Escape(buffer->thread) << "\"}}";
+        first = false;
+        for(int i = 0; i < count; ++i)
+        {
+            const Event &e = buffer->events[i];
+            out << ",\n{\"name\":\"" << Escape(QString::fromUtf8(e.name)) << "\",\"ph\":\"X\""
+                << ",\"ts\":" << e.start << ",\"dur\":" << e.duration
+                << ",\"pid\":" << pid << ",\"tid\":" << buffer->tid << "}";
+        }
+        n += count;
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    out.flush();
+    return f.error() == QFile::NoError ? n : -1;
+}
+
+Scope::Scope(const char *name)
+{
+    if(active.load(std::memory_order_relaxed))
+    {
+        this->name = name;
+        start = Now();
+    }
+    else
+        this->name = nullptr;
+}
+
+Scope::~Scope()
+{
+    if(name != nullptr)
+        Record(name, start, Now()-start);
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef TRACING_H
+#define TRACING_H
+
+#include <QString>
+
+#include "watchdog.h"
+
+// scoped tracing, compiled in with: qmake CONFIG+=tracing
+//  BAKA_TRACE("name") times the enclosing scope; without the switch all that's left of it is
+//  the mark for the stall watchdog (see watchdog.h).
+//  names must be string literals (only the pointer is recorded).
+// events go into per-thread buffers that only their own thread writes to;
+//  `baka trace stop <file>` dumps them as chrome trace_event json (chrome://tracing).
+#if defined(BAKA_TRACING)
+#define BAKA_TRACE_CONCAT2(a, b) a##b
+#define BAKA_TRACE_CONCAT(a, b) BAKA_TRACE_CONCAT2(a, b)
+#define BAKA_TRACE(name) Tracing::Scope BAKA_TRACE_CONCAT(baka_trace_, __LINE__)(name); BAKA_WATCH(name)
+#define BAKA_TRACE_FUNCTION() BAKA_TRACE(Q_FUNC_INFO)
+#else
+#define BAKA_TRACE(name) BAKA_WATCH(name)
+#define BAKA_TRACE_FUNCTION() BAKA_WATCH(Q_FUNC_INFO)
+#endif
+
+namespace Tracing {
+
+bool Supported();   // compiled with CONFIG+=tracing
+bool IsActive();
+void Start();       // clears whatever was recorded before
+void Stop();
+int Save(QString file); // events written, or -1 on error
+
+class Scope
+{
+public:
+    explicit Scope(const char *name);
+    ~Scope();
+
+private:
+    const char *name; // nullptr if tracing wasn't active when we entered
+    qint64 start;
+};
+
+}
+
+#endif // TRACING_H
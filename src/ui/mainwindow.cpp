@@ -5,11 +5,23 @@
 #include <QLibraryInfo>
 #include <QMimeData>
 #include <QDesktopWidget>
+#include <QDir>
+#include <QCoreApplication>
 
 #include "bakaengine.h"
 #include "mpvhandler.h"
 #include "gesturehandler.h"
 #include "overlayhandler.h"
+#include "thumbnailhandler.h"
+#include "waveformhandler.h"
+#include "watchhistory.h"
+#include "sessionjournal.h"
+#include "singleinstance.h"
+#include "controlserver.h"
+#include "headless.h"
+#include "recording.h"
+#include "tracing.h"
+#include "benchmark.h"
 #include "util.h"
 #include "widgets/dimdialog.h"
 #include "inputdialog.h"
@@ -20,6 +32,7 @@ MainWindow::MainWindow(QWidget *parent):
     ui(new Ui::MainWindow)
 {
     ui->setupUi(this);
+    Benchmark::Mark("mainwindow.ui");
 #if defined(Q_OS_UNIX) || defined(Q_OS_LINUX)
     // update streaming support disabled on unix platforms
     ui->actionUpdate_Streaming_Support->setEnabled(false);
@@ -30,6 +43,7 @@ MainWindow::MainWindow(QWidget *parent):
     // initialize managers/handlers
     baka = new BakaEngine(this);
     mpv = baka->mpv;
+    Benchmark::Mark("engine");
 
     ui->playlistWidget->AttachEngine(baka);
     ui->mpvFrame->installEventFilter(this); // capture events on mpvFrame in the eventFilter function
@@ -99,13 +113,15 @@ MainWindow::MainWindow(QWidget *parent):
         {"about", ui->actionAbout_Baka_MPlayer}
     };
 
-    // map actions to commands
+    // map actions to commands (parsed once, here)
     for(auto action = commandActionMap.begin(); action != commandActionMap.end(); ++action)
     {
-        const QString cmd = action.key();
+        const BakaEngine::CompiledCommand run = baka->Compile(action.key());
         connect(*action, &QAction::triggered,
-                [=] { baka->Command(cmd); });
+                [=] { run(); });
     }
+    volumeUp = baka->Compile("volume +5");
+    volumeDown = baka->Compile("volume -5");
 
     // setup signals & slots
 
@@ -135,6 +151,7 @@ MainWindow::MainWindow(QWidget *parent):
                     qApp->installTranslator(baka->translator);
                     if(tmp != nullptr)
                         delete tmp;
+                    Benchmark::Mark("translators");
                 }
                 else
                 {
@@ -197,23 +214,6 @@ MainWindow::MainWindow(QWidget *parent):
                 blockSignals(false);
             });
 
-    connect(baka->sysTrayIcon, &QSystemTrayIcon::activated,
-            [=](QSystemTrayIcon::ActivationReason reason)
-            {
-                if(reason == QSystemTrayIcon::Trigger)
-                {
-                    if(!hidePopup)
-                    {
-                        if(mpv->getPlayState() == Mpv::Playing)
-                            baka->sysTrayIcon->showMessage("Baka MPlayer", tr("Playing"), QSystemTrayIcon::NoIcon, 4000);
-                        else if(mpv->getPlayState() == Mpv::Paused)
-                            baka->sysTrayIcon->showMessage("Baka MPlayer", tr("Paused"), QSystemTrayIcon::NoIcon, 4000);
-                    }
-                    baka->PlayPause();
-                }
-
-            });
-
     //    connect(this, &MainWindow::hidePopupChanged,
     //            [=](bool b)
     //    {
@@ -228,22 +228,12 @@ MainWindow::MainWindow(QWidget *parent):
                     autohide->stop();
             });
 
-    // dimDialog
-    connect(baka->dimDialog, &DimDialog::visbilityChanged,
-            [=](bool dim)
-            {
-                ui->action_Dim_Lights->setChecked(dim);
-                if(dim)
-                    Util::SetAlwaysOnTop(winId(), true);
-                else if(onTop == "never" || (onTop == "playing" && mpv->getPlayState() > 0))
-                    Util::SetAlwaysOnTop(winId(), false);
-            });
-
     // mpv
 
     connect(mpv, &MpvHandler::playlistChanged,
             [=](const QStringList &list)
             {
+                BAKA_TRACE("MainWindow::playlistChanged");
                 if(list.length() > 1)
                 {
                     ui->actionSh_uffle->setEnabled(true);
@@ -265,6 +255,7 @@ MainWindow::MainWindow(QWidget *parent):
     connect(mpv, &MpvHandler::fileInfoChanged,
             [=](const Mpv::FileInfo &fileInfo)
             {
+                BAKA_TRACE("MainWindow::fileInfoChanged");
                 if(mpv->getPlayState() > 0)
                 {
                     if(fileInfo.media_title == "")
@@ -275,27 +266,16 @@ MainWindow::MainWindow(QWidget *parent):
                         setWindowTitle(fileInfo.media_title);
 
                     QString f = mpv->getFile(), file = mpv->getPath()+f;
-                    if(f != QString() && maxRecent > 0)
+                    if(f != QString() && maxRecent > 0 && file != current)
                     {
-                        int i = recent.indexOf(file);
-                        if(i >= 0)
-                        {
-                            int t = recent.at(i).time;
-                            if(t > 0 && resume)
-                                mpv->Seek(t);
-                            recent.removeAt(i);
-                        }
-                        if(recent.isEmpty() || recent.front() != file)
-                        {
-                            UpdateRecentFiles(); // update after initialization and only if the current file is different from the first recent
-                            while(recent.length() > maxRecent-1)
-                                recent.removeLast();
-                            recent.push_front(
-                                Recent(file,
-                                       (mpv->getPath() == QString() || !Util::IsValidFile(file)) ?
-                                           fileInfo.media_title : QString()));
-                            current = &recent.front();
-                        }
+                        int t = baka->history->getTime(file);
+                        if(t > 0 && resume)
+                            mpv->Seek(t);
+                        current = file;
+                        UpdateRecentFiles(); // the menu lists what was played before the current file
+                        baka->history->Touch(file,
+                                             (mpv->getPath() == QString() || !Util::IsValidFile(file)) ?
+                                                 fileInfo.media_title : QString());
                     }
 
                     // reset speed if length isn't known and we have a streaming video
@@ -307,6 +287,17 @@ MainWindow::MainWindow(QWidget *parent):
 
                     ui->seekBar->setTracking(fileInfo.length);
 
+                    // only local videos get seek previews; streams would double the network traffic
+                    bool video = false;
+                    for(auto &track : fileInfo.tracks)
+                        if(track.type == "video" && !track.albumart)
+                            video = true;
+                    baka->thumbnail->setFile((video && mpv->getPath() != QString()) ? mpv->getPath()+mpv->getFile() : QString(),
+                                             fileInfo.length);
+                    // audio files get a waveform strip instead
+                    baka->waveform->setFile((mpv->getPath() != QString() && QDir::match(Mpv::audio_filetypes, mpv->getFile())) ?
+                                            mpv->getPath()+mpv->getFile() : QString());
+
                     if(ui->actionMedia_Info->isChecked())
                         baka->MediaInfo(true);
 
@@ -426,7 +417,7 @@ MainWindow::MainWindow(QWidget *parent):
                         ui->action_Deinterlace->setEnabled(false);
                         ui->action_Motion_Interpolation->setEnabled(false);
 
-                        if(baka->sysTrayIcon->isVisible() && !hidePopup)
+                        if(baka->getTrayIcon() && !hidePopup)
                         {
                             // todo: use {artist} - {title}
                             baka->sysTrayIcon->showMessage("Baka MPlayer", mpv->getFileInfo().media_title, QSystemTrayIcon::NoIcon, 4000);
@@ -487,6 +478,7 @@ MainWindow::MainWindow(QWidget *parent):
     connect(mpv, &MpvHandler::playStateChanged,
             [=](Mpv::PlayState playState)
             {
+                BAKA_TRACE("MainWindow::playStateChanged");
                 switch(playState)
                 {
                 case Mpv::Loaded:
@@ -541,9 +533,12 @@ MainWindow::MainWindow(QWidget *parent):
                                 setWindowTitle("Baka MPlayer");
                                 SetPlaybackControls(false);
                                 ui->seekBar->setTracking(0);
+                                baka->thumbnail->setFile(QString(), 0);
+                                baka->waveform->setFile(QString());
                                 ui->actionStop_after_Current->setChecked(false);
                                 if(ui->mpvFrame->styleSheet() != QString()) // remove filler album art
                                     ui->mpvFrame->setStyleSheet("");
+                                emit playlistFinished();
                             }
                         }
                         else
@@ -562,12 +557,13 @@ MainWindow::MainWindow(QWidget *parent):
       connect(mpv, &MpvHandler::fileChanging,
               [=](int t, int l)
               {
-                  if(current != nullptr)
+                  if(current != QString())
                   {
                       if(t > 0.05*l && t < 0.95*l) // only save if within the middle 90%
-                          current->time = t;
+                          baka->history->setTime(current, t);
                       else
-                          current->time = 0;
+                          baka->history->setTime(current, 0);
+                      current = QString();
                   }
               });
 
@@ -576,9 +572,45 @@ MainWindow::MainWindow(QWidget *parent):
 //            {
 //            });
 
+    // checkpoint the session as it changes (see --restore-session)
+    connect(mpv, &MpvHandler::playlistChanged,
+            [=](const QStringList &list)
+            {
+                baka->session->setPlaylist(mpv->getPath(), list);
+            });
+    connect(ui->playlistWidget, &PlaylistWidget::orderChanged,
+            [=](const QStringList &list)
+            {
+                baka->session->setPlaylist(mpv->getPath(), list);
+            });
+    connect(mpv, &MpvHandler::fileChanged,
+            [=](QString f)
+            {
+                baka->session->setFile(f);
+            });
+    connect(mpv, &MpvHandler::timeChanged,
+            [=](int i)
+            {
+                baka->session->setTime(i);
+            });
+    connect(mpv, &MpvHandler::playStateChanged,
+            [=](Mpv::PlayState playState)
+            {
+                if(playState == Mpv::Paused)
+                    baka->session->setTime(mpv->getTime(), true);
+            });
+    auto tracksChanged = [=]
+            {
+                baka->session->setTracks(mpv->getVid(), mpv->getAid(), mpv->getSid());
+            };
+    connect(mpv, &MpvHandler::vidChanged, tracksChanged);
+    connect(mpv, &MpvHandler::aidChanged, tracksChanged);
+    connect(mpv, &MpvHandler::sidChanged, tracksChanged);
+
     connect(mpv, &MpvHandler::timeChanged,
             [=](int i)
             {
+                BAKA_TRACE("MainWindow::timeChanged");
                 const Mpv::FileInfo &fi = mpv->getFileInfo();
                 // set the seekBar's location with NoSignal function so that it doesn't trigger a seek
                 // the formula is a simple ratio seekBar's max * time/totalTime
@@ -594,6 +626,16 @@ MainWindow::MainWindow(QWidget *parent):
                 }
             });
 
+    connect(mpv, &MpvHandler::cacheStateChanged,
+            [=](const Mpv::CacheState &cacheState)
+            {
+                // only streams are interesting; local files are always "cached"
+                if(mpv->getPath() == QString())
+                    ui->seekBar->setBufferedRanges(cacheState.ranges);
+                else
+                    ui->seekBar->setBufferedRanges({});
+            });
+
     connect(mpv, &MpvHandler::volumeChanged,
             [=](int volume)
             {
@@ -677,68 +719,69 @@ MainWindow::MainWindow(QWidget *parent):
     connect(ui->seekBar, &SeekBar::valueChanged,                        // Playback: Seekbar clicked
             [=](int i)
             {
-                mpv->Seek(mpv->Relative(((double)i/ui->seekBar->maximum())*mpv->getFileInfo().length), true);
+                int pos = mpv->Relative(((double)i/ui->seekBar->maximum())*mpv->getFileInfo().length);
+                baka->Dispatch(QString("mpv seek %0%1").arg(pos >= 0 ? "+" : "", QString::number(pos)),
+                               [=]
+                               {
+                                   mpv->Seek(pos, true);
+                               });
             });
 
+    connect(ui->seekBar, &SeekBar::previewRequested,                    // Playback: Hovering over the seekbar
+            baka->thumbnail, &ThumbnailHandler::request);
+
+    connect(baka->thumbnail, &ThumbnailHandler::thumbnailChanged,
+            ui->seekBar, &SeekBar::setPreview);
+
+    connect(baka->waveform, &WaveformHandler::waveformChanged,
+            ui->seekBar, &SeekBar::setWaveform);
+
+    // the buttons run the commands that do the same, so they're recorded (and held) like the keys
+    const BakaEngine::CompiledCommand open = baka->Compile("open"),
+                                      jump = baka->Compile("jump"),
+                                      location = baka->Compile("open_location"),
+                                      rewind = baka->Compile("rewind"),
+                                      previous = baka->Compile("playlist play -1"),
+                                      playPause = baka->Compile("play_pause"),
+                                      next = baka->Compile("playlist play +1"),
+                                      mute = baka->Compile("mute"),
+                                      playlist = baka->Compile("playlist toggle");
     connect(ui->openButton, &OpenButton::LeftClick,                     // Playback: Open button (left click)
-            [=]
-            {
-                baka->Open();
-            });
+            [=] { open(); });
 
     connect(ui->openButton, &OpenButton::MiddleClick,                   // Playback: Open button (middle click)
-            [=]
-            {
-                baka->Jump();
-            });
+            [=] { jump(); });
 
     connect(ui->openButton, &OpenButton::RightClick,                    // Playback: Open button (right click)
-            [=]
-            {
-                baka->OpenLocation();
-            });
+            [=] { location(); });
 
     connect(ui->rewindButton, &QPushButton::clicked,                    // Playback: Rewind button
-            [=]
-            {
-                mpv->Rewind();
-            });
+            [=] { rewind(); });
 
     connect(ui->previousButton, &IndexButton::clicked,                  // Playback: Previous button
-            [=]
-            {
-                ui->playlistWidget->PlayIndex(-1, true);
-            });
+            [=] { previous(); });
 
     connect(ui->playButton, &QPushButton::clicked,                      // Playback: Play/pause button
-            [=]
-            {
-                baka->PlayPause();
-            });
+            [=] { playPause(); });
 
     connect(ui->nextButton, &IndexButton::clicked,                      // Playback: Next button
-            [=]
-            {
-                ui->playlistWidget->PlayIndex(1, true);
-            });
+            [=] { next(); });
 
     connect(ui->muteButton, &QPushButton::clicked,
-            [=]
-            {
-                mpv->Mute(!mpv->getMute());
-            });
+            [=] { mute(); });
 
     connect(ui->volumeSlider, &CustomSlider::valueChanged,              // Playback: Volume slider adjusted
             [=](int i)
             {
-                mpv->Volume(i, true);
+                baka->Dispatch(QString("volume %0").arg(QString::number(i)),
+                               [=]
+                               {
+                                   mpv->Volume(i, true);
+                               });
             });
 
     connect(ui->playlistButton, &QPushButton::clicked,                  // Playback: Clicked the playlist button
-            [=]
-            {
-                TogglePlaylist();
-            });
+            [=] { playlist(); });
 
     connect(ui->splitter, &CustomSplitter::positionChanged,             // Splitter position changed
             [=](int i)
@@ -823,16 +866,17 @@ MainWindow::MainWindow(QWidget *parent):
 
 MainWindow::~MainWindow()
 {
-    if(current != nullptr)
+    if(current != QString())
     {
         int t = mpv->getTime(),
             l = mpv->getFileInfo().length;
         if(t > 0.05*l && t < 0.95*l) // only save if within the middle 90%
-            current->time = t;
+            baka->history->setTime(current, t);
         else
-            current->time = 0;
+            baka->history->setTime(current, 0);
     }
-    baka->SaveSettings();
+    if(!baka->headless && !baka->replay) // perf runs leave the settings as they found them
+        baka->SaveSettings();
 
     // Note: child objects _should_ not need to be deleted because
     // all children should get deleted when mainwindow is deleted
@@ -849,7 +893,7 @@ MainWindow::~MainWindow()
     delete ui;
 }
 
-void MainWindow::Load(QString file)
+void MainWindow::Load(QString file, bool restore)
 {
     // load the settings here--the constructor has already been called
     // this solves some issues with setting things before the constructor has ended
@@ -894,12 +938,34 @@ void MainWindow::Load(QString file)
     thumbnail_toolbar->addButton(next_toolbutton);
 #endif
     baka->LoadSettings();
+    if(baka->headless)
+        baka->headless->Configure();
+    // mpv brings itself up on a worker while we get back to painting; the file goes in once it's ready
+    connect(mpv, &MpvHandler::initialized,
+            this, [=](bool ok)
+            {
+                if(!ok)
+                    qFatal("Could not initialize mpv");
+                Benchmark::Mark("mpv.initialize");
+                if(!restore || !baka->session->Restore())
+                    mpv->LoadFile(file);
+                Benchmark::Mark("loadfile");
+                baka->setReady(); // input that came in meanwhile goes after the file
+                baka->instance->Start();
+                baka->control->Start();
+                for(auto &arg : QCoreApplication::arguments())
+                    if(arg.startsWith("--script="))
+                        baka->Source(arg.section('=', 1));
+            });
     mpv->Initialize();
-    mpv->LoadFile(file);
 }
 
 void MainWindow::MapShortcuts()
 {
+    // compile the bindings now so a keypress is one lookup and a call, and a bad binding
+    //  is reported here instead of whenever someone happens to press it
+    shortcuts = baka->CompileInput();
+
     auto tmp = commandActionMap;
     // map shortcuts to actions
     for(auto input_iter = baka->input.begin(); input_iter != baka->input.end(); ++input_iter)
@@ -925,18 +991,24 @@ void MainWindow::dragEnterEvent(QDragEnterEvent *event)
 void MainWindow::dropEvent(QDropEvent *event)
 {
     const QMimeData *mimeData = event->mimeData();
+    QStringList files;
     if(mimeData->hasUrls()) // urls
     {
         for(QUrl &url : mimeData->urls())
         {
             if(url.isLocalFile())
-                mpv->LoadFile(url.toLocalFile());
+                files.append(url.toLocalFile());
             else
-                mpv->LoadFile(url.url());
+                files.append(url.url());
         }
     }
     else if(mimeData->hasText()) // text
-        mpv->LoadFile(mimeData->text());
+        files.append(mimeData->text());
+    baka->WhenReady([=]
+                    {
+                        for(auto &file : files)
+                            mpv->LoadFile(file);
+                    });
 }
 
 void MainWindow::mousePressEvent(QMouseEvent *event)
@@ -946,7 +1018,10 @@ void MainWindow::mousePressEvent(QMouseEvent *event)
         if(gestures)
         {
             if(ui->mpvFrame->geometry().contains(event->pos())) // mouse is in the mpvFrame
-                baka->gesture->Begin(GestureHandler::HSEEK_VVOLUME, event->globalPos(), pos());
+            {
+                if(baka->getMpvReady())
+                    baka->gesture->Begin(GestureHandler::HSEEK_VVOLUME, event->globalPos(), pos());
+            }
             else if(!isFullScreen()) // not fullscreen
                 baka->gesture->Begin(GestureHandler::MOVE, event->globalPos(), pos());
         }
@@ -1024,35 +1099,40 @@ bool MainWindow::eventFilter(QObject *obj, QEvent *event)
 void MainWindow::wheelEvent(QWheelEvent *event)
 {
     if(event->delta() > 0)
-        mpv->Volume(mpv->getVolume()+5, true);
+        volumeUp();
     else
-        mpv->Volume(mpv->getVolume()-5, true);
+        volumeDown();
     QMainWindow::wheelEvent(event);
 }
 
 void MainWindow::keyPressEvent(QKeyEvent *event)
 {
+    BAKA_TRACE("MainWindow::keyPressEvent");
+
     // keyboard shortcuts
-    if(!baka->input.empty())
+    if(!shortcuts.empty())
     {
-        QString key = QKeySequence(event->modifiers()|event->key()).toString();
+        int key = event->modifiers()|event->key();
 
         // TODO: Add more protection/find a better way to protect edit boxes from executing commands
         if(focusWidget() == ui->inputLineEdit &&
-           key == "Return")
+           key == Qt::Key_Return)
             return;
 
         // Escape exits fullscreen
         if(isFullScreen() &&
-           key == "Esc") {
+           key == Qt::Key_Escape) {
+            Recording::Key(event->key(), event->modifiers());
             FullScreen(false);
             return;
         }
 
-        // find shortcut in input hash table
-        auto iter = baka->input.find(key);
-        if(iter != baka->input.end())
-            baka->Command(iter->first); // execute command
+        // find shortcut in the compiled bindings; a bound key is recorded as its command
+        auto iter = shortcuts.find(key);
+        if(iter != shortcuts.end())
+            (*iter)(); // execute command
+        else
+            Recording::Key(event->key(), event->modifiers());
     }
 }
 
@@ -1067,10 +1147,13 @@ void MainWindow::mouseDoubleClickEvent(QMouseEvent *event)
 {
     if(event->button() == Qt::LeftButton && ui->mpvFrame->geometry().contains(event->pos())) // if mouse is in the mpvFrame
     {
-        if(!isFullScreen() && ui->action_Full_Screen->isEnabled()) // don't allow people to go full screen if they shouldn't be able to
-            FullScreen(true);
-        else // they can leave fullscreen even if it's disabled (eg. video ends while in full screen)
-            FullScreen(false);
+        bool full = !isFullScreen() && ui->action_Full_Screen->isEnabled(); // don't allow people to go full screen if they shouldn't be able to
+        if(full || isFullScreen()) // they can leave fullscreen even if it's disabled (eg. video ends while in full screen)
+            baka->Dispatch("fullscreen",
+                           [=]
+                           {
+                               FullScreen(full);
+                           });
         event->accept();
     }
     QMainWindow::mouseDoubleClickEvent(event);
@@ -1226,6 +1309,7 @@ void MainWindow::HideAlbumArt(bool hide)
 
 void MainWindow::UpdateRecentFiles()
 {
+    recent = baka->history->getRecent(maxRecent, current);
     ui->menu_Recently_Opened->clear();
     QAction *action;
     int n = 1,
@@ -14,6 +14,8 @@
 #include <QAction>
 #include <QRect>
 
+#include <functional>
+
 #if defined(Q_OS_WIN)
 #include <QWinThumbnailToolBar>
 #include <QWinThumbnailToolButton>
@@ -52,7 +54,7 @@ public:
     Ui::MainWindow  *ui;
     QImage albumArt;
 public slots:
-    void Load(QString f = QString());
+    void Load(QString f = QString(), bool restore = false); // restore picks up the last session instead
     void MapShortcuts();
 
 protected:
@@ -101,8 +103,8 @@ private:
     QTimer          *autohide       = nullptr;
 
     // variables
-    QList<Recent> recent;
-    Recent *current = nullptr;
+    QList<Recent> recent;   // recent files menu, served by baka->history
+    QString current;        // file whose position we're tracking
     QString lang,
             onTop;
     int autoFit,
@@ -115,6 +117,9 @@ private:
          resume,
          hideAllControls = false;
     QHash<QString, QAction*> commandActionMap;
+    QHash<int, std::function<void()>> shortcuts; // modifiers|key -> compiled command; rebuilt by MapShortcuts
+    std::function<void()> volumeUp,              // the mouse wheel
+                          volumeDown;
 
 public slots:
     void setLang(QString s)          { emit langChanged(lang = s); }
@@ -141,6 +146,7 @@ signals:
     void gesturesChanged(bool);
     void resumeChanged(bool);
     void hideAllControlsChanged(bool);
+    void playlistFinished(); // played to the end and stopped
 };
 
 #endif // MAINWINDOW_H
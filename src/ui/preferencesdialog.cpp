@@ -4,7 +4,9 @@
 #include "bakaengine.h"
 #include "ui/mainwindow.h"
 #include "mpvhandler.h"
+#include "singleinstance.h"
 #include "ui/keydialog.h"
+#include "tracing.h"
 
 #include <QFileDialog>
 #include <QMessageBox>
@@ -30,9 +32,10 @@ PreferencesDialog::PreferencesDialog(BakaEngine *baka, QWidget *parent) :
     else if(ontop == "always")
         ui->alwaysRadioButton->setChecked(true);
     ui->resumeCheckBox->setChecked(baka->window->getResume());
-    ui->groupBox_2->setChecked(baka->sysTrayIcon->isVisible());
+    ui->groupBox_2->setChecked(baka->getTrayIcon());
     ui->hidePopupCheckBox->setChecked(baka->window->getHidePopup());
     ui->gestureCheckBox->setChecked(baka->window->getGestures());
+    ui->singleInstanceCheckBox->setChecked(baka->instance->getEnabled());
     ui->langComboBox->setCurrentText(baka->window->getLang());
     int autofit = baka->window->getAutoFit();
     ui->autoFitCheckBox->setChecked((bool)autofit);
@@ -145,9 +148,10 @@ PreferencesDialog::~PreferencesDialog()
             baka->window->setOnTop("playing");
         else if(ui->alwaysRadioButton->isChecked())
             baka->window->setOnTop("always");
-        baka->sysTrayIcon->setVisible(ui->groupBox_2->isChecked());
+        baka->TrayIcon(ui->groupBox_2->isChecked());
         baka->window->setHidePopup(ui->hidePopupCheckBox->isChecked());
         baka->window->setGestures(ui->gestureCheckBox->isChecked());
+        baka->instance->setEnabled(ui->singleInstanceCheckBox->isChecked());
         baka->window->setLang(ui->langComboBox->currentText());
         if(ui->autoFitCheckBox->isChecked())
             baka->window->setAutoFit(ui->comboBox->currentText().left(ui->comboBox->currentText().length()-1).toInt());
@@ -161,6 +165,7 @@ PreferencesDialog::~PreferencesDialog()
         baka->mpv->ScreenshotTemplate(ui->templateLineEdit->text());
         baka->mpv->MsgLevel(ui->msgLvlComboBox->currentText());
         baka->window->MapShortcuts();
+        baka->SaveSettings();
     }
     else
         baka->input = saved;
@@ -176,6 +181,7 @@ void PreferencesDialog::showPreferences(BakaEngine *baka, QWidget *parent)
 
 void PreferencesDialog::PopulateLangs()
 {
+    BAKA_TRACE("PreferencesDialog::PopulateLangs");
     // open the language directory
     QDir root(BAKA_MPLAYER_LANG_PATH);
     // get files in the directory with .qm extension
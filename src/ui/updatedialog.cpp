@@ -23,7 +23,7 @@ UpdateDialog::UpdateDialog(BakaEngine *baka, QWidget *parent) :
     ui->cancelButton->setDefault(true);
 #endif
 
-    connect(baka->update, &UpdateManager::progressSignal,
+    connect(baka->getUpdateManager(), &UpdateManager::progressSignal,
             [=](int percent)
             {
                 ui->progressBar->setValue(percent);
@@ -77,7 +77,7 @@ UpdateDialog::UpdateDialog(BakaEngine *baka, QWidget *parent) :
                 }
             });
 
-    connect(baka->update, &UpdateManager::messageSignal,
+    connect(baka->getUpdateManager(), &UpdateManager::messageSignal,
             [=](QString msg)
             {
                 ui->plainTextEdit->appendPlainText(msg+"\n");
@@ -88,15 +88,15 @@ UpdateDialog::UpdateDialog(BakaEngine *baka, QWidget *parent) :
             [=]
             {
                 ui->plainTextEdit->setPlainText(QString());
-                baka->update->DownloadUpdate(Util::DownloadFileUrl());
+                baka->getUpdateManager()->DownloadUpdate(Util::DownloadFileUrl());
             });
 #endif
 
     connect(ui->cancelButton, SIGNAL(clicked()),
             this, SLOT(reject()));
 
-    if(baka->update->getInfo().empty())
-        baka->update->CheckForUpdates();
+    if(baka->getUpdateManager()->getInfo().empty())
+        baka->getUpdateManager()->CheckForUpdates();
     else
     {
         init = false;
@@ -119,7 +119,7 @@ void UpdateDialog::CheckForUpdates(BakaEngine *baka, QWidget *parent)
 
 void UpdateDialog::ShowInfo()
 {
-    auto &info = baka->update->getInfo();
+    auto &info = baka->getUpdateManager()->getInfo();
     ui->plainTextEdit->setPlainText(info["bugfixes"]);
     if(info["version"].trimmed() == BAKA_MPLAYER_VERSION)
     {
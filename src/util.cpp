@@ -3,6 +3,11 @@
 #include <QTime>
 #include <QStringListIterator>
 #include <QDir>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+#include <algorithm> // for std::sort
 
 namespace Util {
 
@@ -125,6 +130,16 @@ QString ShortenPathToParent(const Recent &recent)
     return QDir::toNativeSeparators(recent.path);
 }
 
+QString FileIdentity(QString file)
+{
+    // identify the file by path, size and modification time so edits invalidate anything cached for it
+    QFileInfo fi(file);
+    QByteArray id = QString("%0|%1|%2").arg(fi.absoluteFilePath(),
+                                           QString::number(fi.size()),
+                                           QString::number(fi.lastModified().toMSecsSinceEpoch())).toUtf8();
+    return QCryptographicHash::hash(id, QCryptographicHash::Sha1).toHex();
+}
+
 QStringList ToNativeSeparators(QStringList list)
 {
     QStringList ret;
@@ -181,4 +196,17 @@ QString Ratio(int w, int h)
     return QString("%0:%1").arg(QString::number(w/gcd), QString::number(h/gcd));
 }
 
+QJsonObject Stats(QVector<double> values)
+{
+    QJsonObject stats;
+    if(values.isEmpty())
+        return stats;
+    std::sort(values.begin(), values.end());
+    stats["min"] = values.first();
+    stats["median"] = values[values.size()/2];
+    stats["p99"] = values[qMin(values.size()-1, int(values.size()*0.99))];
+    stats["max"] = values.last();
+    return stats;
+}
+
 }
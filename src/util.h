@@ -4,6 +4,8 @@
 #include <QWidget>
 #include <QString>
 #include <QTextStream>
+#include <QVector>
+#include <QJsonObject>
 #include "recent.h"
 
 class Settings;
@@ -34,10 +36,12 @@ QString FormatNumber(int val, int length);
 QString FormatNumberWithAmpersand(int val, int length);
 QString HumanSize(qint64);
 QString ShortenPathToParent(const Recent &recent);
+QString FileIdentity(QString file);
 QStringList ToNativeSeparators(QStringList list);
 QStringList FromNativeSeparators(QStringList list);
 int GCD(int v, int u);
 QString Ratio(int w, int h);
+QJsonObject Stats(QVector<double> values); // min, median, p99 and max, for the perf reports
 
 }
 
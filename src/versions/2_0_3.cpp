@@ -5,6 +5,13 @@
 #include "settings.h"
 #include "util.h"
 #include "mpvhandler.h"
+#include "overlayhandler.h"
+#include "thumbnailhandler.h"
+#include "waveformhandler.h"
+#include "logfile.h"
+#include "watchhistory.h"
+#include "singleinstance.h"
+#include "watchdog.h"
 
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -12,6 +19,7 @@
 #include <QJsonValue>
 #include <QJsonValueRef>
 #include <QDir>
+#include <QDateTime>
 
 #if defined(Q_OS_WIN)
 #include <QDate>
@@ -55,7 +63,7 @@ void BakaEngine::Load2_0_3()
     QJsonObject root = settings->getRoot();
     window->setOnTop(QJsonValueRef2(root["onTop"]).toString("never"));
     window->setAutoFit(QJsonValueRef2(root["autoFit"]).toInt(100));
-    sysTrayIcon->setVisible(QJsonValueRef2(root["trayIcon"]).toBool(false));
+    TrayIcon(QJsonValueRef2(root["trayIcon"]).toBool(false));
     window->setHidePopup(QJsonValueRef2(root["hidePopup"]).toBool(false));
     window->setRemaining(QJsonValueRef2(root["remaining"]).toBool(true));
     window->ui->splitter->setNormalPosition(QJsonValueRef2(root["splitter"]).toInt(window->ui->splitter->max()*1.0/8));
@@ -63,22 +71,36 @@ void BakaEngine::Load2_0_3()
     //window->ui->hideFilesButton->setChecked(!QJsonValueRef2(root["showAll"]).toBool(true));
     root["showAll"] = true;
     window->setScreenshotDialog(QJsonValueRef2(root["screenshotDialog"]).toBool(true));
-    window->recent.clear();
-    for(auto entry : root["recent"].toArray())
+    // recent files used to live here; move them over to the watch history (oldest first)
+    QJsonArray recent_json = root["recent"].toArray();
+    qint64 now = QDateTime::currentMSecsSinceEpoch();
+    for(int i = recent_json.size()-1; i >= 0; --i)
     {
-        QJsonObject entry_json = entry.toObject();
-        window->recent.append(Recent(entry_json["path"].toString(), entry_json["title"].toString(), QJsonValueRef2(entry_json["time"]).toInt(0)));
+        QJsonObject entry_json = recent_json[i].toObject();
+        history->Import(entry_json["path"].toString(), entry_json["title"].toString(), QJsonValueRef2(entry_json["time"]).toInt(0), now-i);
     }
     window->setMaxRecent(QJsonValueRef2(root["maxRecent"]).toInt(5));
     window->setGestures(QJsonValueRef2(root["gestures"]).toBool(true));
     window->setResume(QJsonValueRef2(root["resume"]).toBool(true));
+    instance->setEnabled(QJsonValueRef2(root["singleInstance"]).toBool(false));
     window->setHideAllControls(QJsonValueRef2(root["hideAllControls"]).toBool(false));
     window->setLang(QJsonValueRef2(root["lang"]).toString("auto"));
+    overlay->setNativeOsd(QJsonValueRef2(root["nativeOsd"]).toBool(true));
+    thumbnail->setEnabled(QJsonValueRef2(root["seekPreview"]).toBool(true));
+    waveform->setEnabled(QJsonValueRef2(root["waveform"]).toBool(true));
+    watchdog->setThreshold(QJsonValueRef2(root["stallThreshold"]).toInt(250));
+    QJsonObject log_json = root["log"].toObject();
+    logFile->setFile(QJsonValueRef2(log_json["file"]).toString(QString()));
+    logFile->setRotation(qint64(QJsonValueRef2(log_json["maxSize"]).toInt(4096))*1024,
+                         QJsonValueRef2(log_json["maxAge"]).toInt(0),
+                         QJsonValueRef2(log_json["keep"]).toInt(5),
+                         QJsonValueRef2(log_json["compress"]).toBool(false));
+    logFile->setEnabled(QJsonValueRef2(log_json["enabled"]).toBool(false));
 #if defined(Q_OS_WIN)
     QDate last = QDate::fromString(root["lastcheck"].toString()); // convert to date
     if(last.daysTo(QDate::currentDate()) > 7) // been a week since we last checked?
     {
-        update->CheckForUpdates();
+        getUpdateManager()->CheckForUpdates();
         root["lastcheck"] = QDate::currentDate().toString();
     }
 #endif
@@ -124,7 +146,7 @@ void BakaEngine::SaveSettings()
     QJsonObject root = settings->getRoot();
     root["onTop"] = window->onTop;
     root["autoFit"] = window->autoFit;
-    root["trayIcon"] = sysTrayIcon->isVisible();
+    root["trayIcon"] = getTrayIcon();
     root["hidePopup"] = window->hidePopup;
     root["remaining"] = window->remaining;
     root["splitter"] = (window->ui->splitter->position() == 0 ||
@@ -138,21 +160,22 @@ void BakaEngine::SaveSettings()
     root["lang"] = window->lang;
     root["gestures"] = window->gestures;
     root["resume"] = window->resume;
+    root["singleInstance"] = instance->getEnabled();
     root["hideAllControls"] = window->hideAllControls;
+    root["nativeOsd"] = overlay->getNativeOsd();
+    root["seekPreview"] = thumbnail->getEnabled();
+    root["waveform"] = waveform->getEnabled();
+    root["stallThreshold"] = watchdog->getThreshold();
+    QJsonObject log_json;
+    log_json["enabled"] = logFile->getEnabled();
+    log_json["file"] = logFile->getFile();
+    log_json["maxSize"] = int(logFile->getMaxSize()/1024);
+    log_json["maxAge"] = logFile->getMaxAge();
+    log_json["keep"] = logFile->getKeep();
+    log_json["compress"] = logFile->getCompress();
+    root["log"] = log_json;
     root["version"] = version;
-
-    QJsonArray recent_json;
-    for(auto &entry : window->recent)
-    {
-        QJsonObject recent_sub_object_json;
-        recent_sub_object_json["path"] = QDir::fromNativeSeparators(entry.path);
-        if(entry.title != QString())
-            recent_sub_object_json["title"] = entry.title;
-        if(entry.time > 0)
-            recent_sub_object_json["time"] = entry.time;
-        recent_json.append(recent_sub_object_json);
-    }
-    root["recent"] = recent_json;
+    root.remove("recent"); // kept in the watch history now
 
     QJsonObject input_json;
     for(auto input_iter = input.begin(); input_iter != input.end(); ++input_iter)
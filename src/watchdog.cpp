@@ -0,0 +1,141 @@
+#include "watchdog.h"
+
+#include <QCoreApplication>
+#include <QEvent>
+#include <QStringList>
+#include <QMutexLocker>
+
+#include <atomic>
+
+#define WATCHDOG_INTERVAL 100   // ms between pings
+#define WATCHDOG_DEPTH 8        // nested sites kept; deeper ones still count, unnamed
+
+static const QEvent::Type watchdog_ping = QEvent::Type(QEvent::registerEventType());
+
+// written only by the gui thread; the watchdog reads them while it's stuck
+static std::atomic<const char*> sites[WATCHDOG_DEPTH];
+static std::atomic<int> depth{0};
+
+static bool OnGuiThread()
+{
+    static thread_local int gui = -1; // unknown until there's an application to ask
+    if(gui == -1 && QCoreApplication::instance() != nullptr)
+        gui = QThread::currentThread() == QCoreApplication::instance()->thread();
+    return gui == 1;
+}
+
+Watchdog::Site::Site(const char *name):
+    entered(OnGuiThread())
+{
+    if(!entered)
+        return;
+    int d = depth.load(std::memory_order_relaxed);
+    if(d < WATCHDOG_DEPTH)
+        sites[d].store(name, std::memory_order_relaxed);
+    depth.store(d+1, std::memory_order_release);
+}
+
+Watchdog::Site::~Site()
+{
+    if(entered)
+        depth.store(depth.load(std::memory_order_relaxed)-1, std::memory_order_release);
+}
+
+Watchdog::Watchdog(QObject *parent):
+    QThread(parent)
+{
+    clock.start();
+}
+
+Watchdog::~Watchdog()
+{
+    mutex.lock();
+    quit = true;
+    condition.wakeAll();
+    mutex.unlock();
+    wait();
+}
+
+QHash<QString, Watchdog::Stalls> Watchdog::getStalls()
+{
+    QMutexLocker locker(&mutex);
+    return stalls;
+}
+
+void Watchdog::setThreshold(int ms)
+{
+    QMutexLocker locker(&mutex);
+    threshold = qMax(0, ms);
+    if(threshold > 0 && !isRunning())
+        start();
+    condition.wakeAll();
+}
+
+void Watchdog::Reset()
+{
+    QMutexLocker locker(&mutex);
+    stalls.clear();
+}
+
+QString Watchdog::ActiveSite()
+{
+    int d = qMin(depth.load(std::memory_order_acquire), WATCHDOG_DEPTH);
+    QStringList names;
+    for(int i = 0; i < d; ++i)
+        names.append(QString::fromLatin1(sites[i].load(std::memory_order_relaxed)));
+    if(names.isEmpty())
+        return "(unmarked)";
+    return names.join(" > ");
+}
+
+void Watchdog::run()
+{
+    QMutexLocker locker(&mutex);
+    while(!quit)
+    {
+        if(threshold == 0)
+        {
+            condition.wait(&mutex);
+            continue;
+        }
+        answered = false;
+        qint64 sent = clock.elapsed();
+        QCoreApplication::postEvent(this, new QEvent(watchdog_ping));
+        QString site; // set once it's a stall
+        while(!quit && !answered)
+        {
+            qint64 waited = clock.elapsed()-sent;
+            if(site == QString() && threshold > 0 && waited >= threshold)
+                site = ActiveSite(); // whoever has the gui thread now is the one holding it up
+            if(site == QString() && threshold > 0)
+                condition.wait(&mutex, ulong(threshold-waited));
+            else
+                condition.wait(&mutex);
+        }
+        if(quit)
+            break;
+        if(site != QString())
+        {
+            double ms = answeredAt-sent;
+            Stalls &s = stalls[site];
+            ++s.count;
+            s.total += ms;
+            s.max = qMax(s.max, ms);
+            emit messageSignal(tr("gui stalled for %0 ms in %1").arg(QString::number(ms), site));
+        }
+        condition.wait(&mutex, WATCHDOG_INTERVAL);
+    }
+}
+
+bool Watchdog::event(QEvent *event)
+{
+    if(event->type() == watchdog_ping)
+    {
+        QMutexLocker locker(&mutex);
+        answered = true;
+        answeredAt = clock.elapsed();
+        condition.wakeAll();
+        return true;
+    }
+    return QThread::event(event);
+}
@@ -0,0 +1,74 @@
+#ifndef WATCHDOG_H
+#define WATCHDOG_H
+
+#include <QThread>
+#include <QString>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+
+// BAKA_WATCH("name") marks what the gui thread is busy with for the enclosing scope, so a stall
+//  can be put down to it; traced scopes (tracing.h) are marked too. on other threads it does
+//  nothing. names must be string literals (only the pointer is kept).
+#define BAKA_WATCH_CONCAT2(a, b) a##b
+#define BAKA_WATCH_CONCAT(a, b) BAKA_WATCH_CONCAT2(a, b)
+#define BAKA_WATCH(name) Watchdog::Site BAKA_WATCH_CONCAT(baka_watch_, __LINE__)(name)
+
+// pings the gui event loop from a thread of its own. an answer that takes longer than the
+//  threshold is a stall: it's logged with the sites that were active on the gui thread when
+//  it was noticed ("outer > inner"), and counted per site for `baka stalls`.
+// modal dialogs run an event loop of their own, so waiting on one isn't a stall.
+class Watchdog : public QThread
+{
+    Q_OBJECT
+public:
+    class Site
+    {
+    public:
+        explicit Site(const char *name);
+        ~Site();
+
+    private:
+        bool entered; // only the gui thread's sites are kept
+    };
+
+    struct Stalls
+    {
+        int count;
+        double total,   // ms
+               max;
+    };
+
+    explicit Watchdog(QObject *parent = 0);
+    ~Watchdog();
+
+    int getThreshold()      { return threshold; }
+    QHash<QString, Stalls> getStalls();
+
+public slots:
+    void setThreshold(int ms); // 0 disables
+    void Reset();
+
+signals:
+    void messageSignal(QString m);
+
+protected:
+    void run();
+    bool event(QEvent *event); // the pings
+
+private:
+    static QString ActiveSite();
+
+    QElapsedTimer clock;
+    // shared with the worker thread, guarded by mutex
+    QMutex mutex;
+    QWaitCondition condition;
+    QHash<QString, Stalls> stalls;
+    int threshold = 0;
+    bool quit = false,
+         answered = false;
+    qint64 answeredAt = 0;  // ms, on clock
+};
+
+#endif // WATCHDOG_H
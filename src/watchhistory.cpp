@@ -0,0 +1,296 @@
+#include "watchhistory.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QDateTime>
+#include <QCryptographicHash>
+#include <QtEndian>
+
+#include <algorithm>
+#include <vector>
+
+#include "util.h"
+
+#define HISTORY_MAGIC 0x424b5748 // "BKWH"
+#define HISTORY_VERSION 1
+#define HISTORY_HEADER 8        // magic, version
+#define HISTORY_RECENT 100      // entries kept in recently played order
+#define HISTORY_COMPACT 4096    // stale records tolerated on top of the live ones before compacting
+
+// record layouts (little endian):
+//  entry: type, key[20], stamp (i64), time (i32), path length (u16), path, title length (u16), title
+//  time:  type, key[20], time (i32)
+#define RECORD_ENTRY 1
+#define RECORD_TIME 2
+#define KEY_SIZE 20
+#define ENTRY_FIXED (1+KEY_SIZE+8+4+2)
+#define TIME_SIZE (1+KEY_SIZE+4)
+
+WatchHistory::WatchHistory(QString file, QObject *parent):
+    QObject(parent),
+    file(file)
+{
+}
+
+WatchHistory::~WatchHistory()
+{
+    if(log.isOpen() && records > 2*index.size() + HISTORY_COMPACT)
+        Compact();
+    log.close();
+}
+
+void WatchHistory::Open()
+{
+    log.close();
+    index.clear();
+    mru.clear();
+    records = 0;
+
+    QDir().mkpath(QFileInfo(file).absolutePath());
+
+    QFile in(file);
+    qint64 size = 0,
+           good = HISTORY_HEADER; // end of the last complete record
+    bool valid = false;
+    if(in.open(QIODevice::ReadOnly) && (size = in.size()) >= HISTORY_HEADER)
+    {
+        QByteArray buffer;
+        const uchar *data = in.map(0, size);
+        if(!data)
+        {
+            buffer = in.readAll();
+            data = reinterpret_cast<const uchar*>(buffer.constData());
+        }
+        if(qFromLittleEndian<quint32>(data) == HISTORY_MAGIC &&
+           qFromLittleEndian<quint32>(data+4) == HISTORY_VERSION)
+        {
+            valid = true;
+            index.reserve(int(size/(ENTRY_FIXED+64)));
+            const uchar *p = data+HISTORY_HEADER,
+                        *end = data+size;
+            while(p < end)
+            {
+                if(*p == RECORD_TIME)
+                {
+                    if(end-p < TIME_SIZE)
+                        break;
+                    auto i = index.find(QByteArray::fromRawData(reinterpret_cast<const char*>(p+1), KEY_SIZE));
+                    if(i != index.end())
+                        i->time = qFromLittleEndian<qint32>(p+1+KEY_SIZE);
+                    p += TIME_SIZE;
+                }
+                else if(*p == RECORD_ENTRY)
+                {
+                    if(end-p < ENTRY_FIXED)
+                        break;
+                    int path_len = qFromLittleEndian<quint16>(p+ENTRY_FIXED-2);
+                    if(end-p < ENTRY_FIXED+path_len+2)
+                        break;
+                    int title_len = qFromLittleEndian<quint16>(p+ENTRY_FIXED+path_len);
+                    if(end-p < ENTRY_FIXED+path_len+2+title_len)
+                        break;
+                    Entry &entry = index[QByteArray(reinterpret_cast<const char*>(p+1), KEY_SIZE)];
+                    entry.stamp = qFromLittleEndian<qint64>(p+1+KEY_SIZE);
+                    entry.time = qFromLittleEndian<qint32>(p+1+KEY_SIZE+8);
+                    entry.path = QByteArray(reinterpret_cast<const char*>(p+ENTRY_FIXED), path_len);
+                    entry.title = QByteArray(reinterpret_cast<const char*>(p+ENTRY_FIXED+path_len+2), title_len);
+                    p += ENTRY_FIXED+path_len+2+title_len;
+                }
+                else // unknown record; nothing after it can be trusted
+                    break;
+                ++records;
+                good = p-data;
+            }
+        }
+    }
+    in.close();
+
+    if(!valid) // new (or unreadable) history
+    {
+        log.setFileName(file);
+        if(!log.open(QIODevice::WriteOnly | QIODevice::Truncate))
+            return;
+        uchar header[HISTORY_HEADER];
+        qToLittleEndian<quint32>(HISTORY_MAGIC, header);
+        qToLittleEndian<quint32>(HISTORY_VERSION, header+4);
+        log.write(reinterpret_cast<const char*>(header), HISTORY_HEADER);
+        log.close();
+    }
+    else if(good < size) // a write was cut short (crash); drop the partial record
+        QFile::resize(file, good);
+
+    // only the top of the recent list needs to be ordered
+    std::vector<std::pair<qint64, QByteArray>> stamps;
+    stamps.reserve(index.size());
+    for(auto i = index.constBegin(); i != index.constEnd(); ++i)
+        stamps.push_back({i->stamp, i.key()});
+    auto top = stamps.begin()+std::min<size_t>(HISTORY_RECENT, stamps.size());
+    std::partial_sort(stamps.begin(), top, stamps.end(),
+                      [](const std::pair<qint64, QByteArray> &a, const std::pair<qint64, QByteArray> &b)
+                      {
+                          return a.first > b.first;
+                      });
+    for(auto i = stamps.begin(); i != top; ++i)
+        mru.append(i->second);
+
+    log.setFileName(file);
+    log.open(QIODevice::WriteOnly | QIODevice::Append);
+
+    if(records > 2*index.size() + HISTORY_COMPACT)
+        Compact();
+}
+
+bool WatchHistory::Contains(QString path)
+{
+    return index.contains(Key(path));
+}
+
+int WatchHistory::getTime(QString path)
+{
+    auto i = index.find(Key(path));
+    return i != index.end() ? i->time : 0;
+}
+
+QList<Recent> WatchHistory::getRecent(int n, QString exclude)
+{
+    QList<Recent> list;
+    QByteArray skip = exclude.toUtf8();
+    for(auto &key : mru)
+    {
+        if(list.length() >= n)
+            break;
+        const Entry &entry = index[key];
+        if(entry.path != skip)
+            list.append(Recent(QString::fromUtf8(entry.path), QString::fromUtf8(entry.title), entry.time));
+    }
+    return list;
+}
+
+void WatchHistory::Touch(QString path, QString title)
+{
+    QByteArray key = Key(path);
+    Entry &entry = index[key];
+    entry.path = path.toUtf8();
+    entry.title = title.toUtf8();
+    entry.stamp = QDateTime::currentMSecsSinceEpoch();
+    Append(RECORD_ENTRY, key, entry);
+    Promote(key);
+}
+
+void WatchHistory::setTime(QString path, int time)
+{
+    QByteArray key = Key(path);
+    auto i = index.find(key);
+    if(i == index.end() || i->time == time)
+        return;
+    i->time = time;
+    Append(RECORD_TIME, key, *i);
+}
+
+void WatchHistory::Import(QString path, QString title, int time, qint64 stamp)
+{
+    QByteArray key = Key(path);
+    if(index.contains(key))
+        return;
+    Entry &entry = index[key];
+    entry.path = path.toUtf8();
+    entry.title = title.toUtf8();
+    entry.time = time;
+    entry.stamp = stamp;
+    Append(RECORD_ENTRY, key, entry);
+
+    int i = 0;
+    while(i < mru.length() && index[mru[i]].stamp >= stamp)
+        ++i;
+    if(i < HISTORY_RECENT)
+    {
+        mru.insert(i, key);
+        while(mru.length() > HISTORY_RECENT)
+            mru.removeLast();
+    }
+}
+
+QByteArray WatchHistory::Key(QString path)
+{
+    // local files are also identified by size and mtime; streams only by their url
+    QByteArray id = path.toUtf8();
+    if(Util::IsValidFile(path))
+        id += '|'+Util::FileIdentity(path).toUtf8();
+    return QCryptographicHash::hash(id, QCryptographicHash::Sha1);
+}
+
+static QByteArray Record(char type, const QByteArray &key, qint64 stamp, int time, const QByteArray &p, const QByteArray &t)
+{
+    QByteArray record;
+    uchar buf[8];
+    record.append(type);
+    record.append(key);
+    if(type == RECORD_ENTRY)
+    {
+        if(p.size() > 0xffff || t.size() > 0xffff)
+            return QByteArray();
+        qToLittleEndian<qint64>(stamp, buf);
+        record.append(reinterpret_cast<const char*>(buf), 8);
+        qToLittleEndian<qint32>(time, buf);
+        record.append(reinterpret_cast<const char*>(buf), 4);
+        qToLittleEndian<quint16>(p.size(), buf);
+        record.append(reinterpret_cast<const char*>(buf), 2);
+        record.append(p);
+        qToLittleEndian<quint16>(t.size(), buf);
+        record.append(reinterpret_cast<const char*>(buf), 2);
+        record.append(t);
+    }
+    else
+    {
+        qToLittleEndian<qint32>(time, buf);
+        record.append(reinterpret_cast<const char*>(buf), 4);
+    }
+    return record;
+}
+
+void WatchHistory::Append(char type, const QByteArray &key, const Entry &entry)
+{
+    QByteArray record = Record(type, key, entry.stamp, entry.time, entry.path, entry.title);
+    if(record.isEmpty() || !log.isOpen())
+        return;
+    // one write per record; a crash can only ever cut off the last one
+    log.write(record);
+    log.flush();
+    ++records; // compacting is a full rewrite; it waits for shutdown (or the next Open)
+}
+
+void WatchHistory::Compact()
+{
+    // rewrite the live entries oldest first, so replaying the log rebuilds the same order
+    std::vector<std::pair<qint64, QByteArray>> stamps;
+    stamps.reserve(index.size());
+    for(auto i = index.constBegin(); i != index.constEnd(); ++i)
+        stamps.push_back({i->stamp, i.key()});
+    std::sort(stamps.begin(), stamps.end());
+
+    QSaveFile out(file);
+    if(!out.open(QIODevice::WriteOnly))
+        return;
+    uchar header[HISTORY_HEADER];
+    qToLittleEndian<quint32>(HISTORY_MAGIC, header);
+    qToLittleEndian<quint32>(HISTORY_VERSION, header+4);
+    out.write(reinterpret_cast<const char*>(header), HISTORY_HEADER);
+    for(auto &s : stamps)
+    {
+        const Entry &entry = index[s.second];
+        out.write(Record(RECORD_ENTRY, s.second, entry.stamp, entry.time, entry.path, entry.title));
+    }
+    log.close();
+    if(out.commit())
+        records = index.size();
+    log.open(QIODevice::WriteOnly | QIODevice::Append);
+}
+
+void WatchHistory::Promote(const QByteArray &key)
+{
+    mru.removeOne(key);
+    mru.prepend(key);
+    while(mru.length() > HISTORY_RECENT)
+        mru.removeLast();
+}
@@ -0,0 +1,57 @@
+#ifndef WATCHHISTORY_H
+#define WATCHHISTORY_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QList>
+#include <QFile>
+
+#include "recent.h"
+
+// every file we've played and where we left off.
+// the store is an append-only log of fixed-layout records; the latest record for a key wins.
+//  it's read once into a hash index on open (on the engine's loader thread) and rewritten (compacted)
+//  there or at shutdown when most of it is stale; never in the middle of playback.
+class WatchHistory : public QObject
+{
+    Q_OBJECT
+public:
+    explicit WatchHistory(QString file, QObject *parent = 0);
+    ~WatchHistory();
+
+    void Open();
+
+    bool Contains(QString path);
+    int getTime(QString path);                              // 0 if unknown
+    QList<Recent> getRecent(int n, QString exclude = QString()); // most recently played first
+
+public slots:
+    void Touch(QString path, QString title = QString());    // played now; moves it to the front of the recent list
+    void setTime(QString path, int time);
+    void Import(QString path, QString title, int time, qint64 stamp); // adds an entry unless it exists
+
+protected:
+    struct Entry
+    {
+        QByteArray path,    // utf8, decoded only when the recent list is asked for
+                   title;
+        qint64 stamp = 0;   // ms since epoch it was last played
+        int time = 0;       // resume position
+    };
+
+    QByteArray Key(QString path);
+    void Append(char type, const QByteArray &key, const Entry &entry);
+    void Compact();
+    void Promote(const QByteArray &key);
+
+private:
+    QString file;
+    QFile log;
+    QHash<QByteArray, Entry> index;
+    QList<QByteArray> mru;  // keys of the most recently played entries, newest first
+    qint64 records = 0;     // records in the log, live or not
+};
+
+#endif // WATCHHISTORY_H
@@ -0,0 +1,365 @@
+#include "waveformhandler.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QDir>
+#include <QDataStream>
+#include <QStandardPaths>
+#include <QTemporaryFile>
+#include <QMutexLocker>
+
+#include <cmath>
+#include <algorithm> // for std::min and std::max
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "util.h"
+
+#define WAVEFORM_RATE 8000      // mpv resamples to this (mono, s16) before we reduce it
+#define WAVEFORM_WINDOW 160     // samples per level 0 window (20ms)
+#define WAVEFORM_SEGMENT 600    // seconds decoded per temporary pcm file (9.6MB of it)
+#define WAVEFORM_MAX_LEVELS 32  // more than any file's count of windows could halve to
+#define WAVEFORM_MAGIC 0x424b5746 // "BKWF"
+#define WAVEFORM_VERSION 1
+
+int WaveformPeaks::levelFor(int columns) const
+{
+    int level = 0;
+    while(level+1 < levels.length() && count(level+1) >= columns)
+        ++level;
+    return level;
+}
+
+// reduces a window of samples to its min, max and sum of squares
+static void ReduceWindow(const qint16 *s, int n, qint16 &min, qint16 &max, double &sumsq)
+{
+    int i = 0;
+    qint16 lo = 32767, hi = -32768;
+    double sq = 0;
+#if defined(__SSE2__)
+    if(n >= 8)
+    {
+        __m128i vmin = _mm_set1_epi16(32767),
+                vmax = _mm_set1_epi16(-32768);
+        __m128 vsq = _mm_setzero_ps();
+        for(; i+8 <= n; i += 8)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*)(s+i));
+            vmin = _mm_min_epi16(vmin, v);
+            vmax = _mm_max_epi16(vmax, v);
+            // halve before squaring so the pairwise int32 sums from madd can't overflow
+            __m128i h = _mm_srai_epi16(v, 1);
+            vsq = _mm_add_ps(vsq, _mm_cvtepi32_ps(_mm_madd_epi16(h, h)));
+        }
+        qint16 mins[8], maxs[8];
+        float sqs[4];
+        _mm_storeu_si128((__m128i*)mins, vmin);
+        _mm_storeu_si128((__m128i*)maxs, vmax);
+        _mm_storeu_ps(sqs, vsq);
+        for(int j = 0; j < 8; ++j)
+        {
+            lo = std::min(lo, mins[j]);
+            hi = std::max(hi, maxs[j]);
+        }
+        sq = 4.0*(double(sqs[0]) + sqs[1] + sqs[2] + sqs[3]);
+    }
+#endif
+    for(; i < n; ++i)
+    {
+        lo = std::min(lo, s[i]);
+        hi = std::max(hi, s[i]);
+        sq += double(s[i])*s[i];
+    }
+    min = lo;
+    max = hi;
+    sumsq = sq;
+}
+
+static void AppendWindow(QByteArray &level, const qint16 *s, int n)
+{
+    qint16 min, max;
+    double sumsq;
+    ReduceWindow(s, n, min, max, sumsq);
+    level.append(char(min >> 8));
+    level.append(char(max >> 8));
+    level.append(char(std::min(255, int(std::sqrt(sumsq/n)/128))));
+}
+
+// builds the coarser levels by merging neighbouring windows
+static void BuildLevels(WaveformPeaks &peaks)
+{
+    while(peaks.count(peaks.levels.length()-1) > 1)
+    {
+        const QByteArray &fine = peaks.levels.last();
+        QByteArray coarse;
+        coarse.reserve(fine.size()/2+3);
+        for(int i = 0; i+3 <= fine.size(); i += 6)
+        {
+            if(i+6 > fine.size()) // odd window out
+            {
+                coarse.append(fine.mid(i, 3));
+                break;
+            }
+            int rms1 = quint8(fine[i+2]),
+                rms2 = quint8(fine[i+5]);
+            coarse.append(std::min(fine[i], fine[i+3]));
+            coarse.append(std::max(fine[i+1], fine[i+4]));
+            coarse.append(char(int(std::sqrt((rms1*rms1 + rms2*rms2)/2.0))));
+        }
+        peaks.levels.append(coarse);
+    }
+}
+
+WaveformHandler::WaveformHandler(QObject *parent):
+    QThread(parent)
+{
+    qRegisterMetaType<WaveformPeaks>("WaveformPeaks");
+    connect(this, &WaveformHandler::decoded,
+            this, &WaveformHandler::Insert,
+            Qt::QueuedConnection);
+}
+
+WaveformHandler::~WaveformHandler()
+{
+    mutex.lock();
+    quit = true;
+    condition.wakeAll();
+    mutex.unlock();
+    wait();
+}
+
+void WaveformHandler::setEnabled(bool b)
+{
+    enabled = b;
+    if(!b)
+        setFile(QString());
+}
+
+void WaveformHandler::setFile(QString f)
+{
+    if(!enabled)
+        f = QString();
+
+    QMutexLocker lock(&mutex);
+    if(f == file)
+        return;
+    file = f;
+    ++generation;
+    emit waveformChanged(WaveformPeaks()); // clear the old one right away
+    if(file != QString() && !isRunning()) // the worker is only started once it's needed
+        start(QThread::LowPriority);
+    condition.wakeAll();
+}
+
+void WaveformHandler::Insert(int gen, const WaveformPeaks &peaks)
+{
+    mutex.lock();
+    bool stale = (gen != generation);
+    mutex.unlock();
+    if(!stale)
+        emit waveformChanged(peaks);
+}
+
+void WaveformHandler::run()
+{
+    int done = 0; // last generation we handled
+    forever
+    {
+        mutex.lock();
+        while(!quit && done == generation)
+            condition.wait(&mutex);
+        if(quit)
+        {
+            mutex.unlock();
+            break;
+        }
+        QString f = file;
+        int gen = done = generation;
+        mutex.unlock();
+
+        if(f == QString())
+            continue;
+
+        // peak files make re-opening instant; only decode what we haven't seen before
+        QString peakFile = PeakFile(f);
+        WaveformPeaks peaks = Load(peakFile);
+        if(peaks.isEmpty())
+        {
+            peaks = Decode(f, gen);
+            if(!peaks.isEmpty())
+                Save(peakFile, peaks);
+        }
+        if(!peaks.isEmpty())
+            emit decoded(gen, peaks);
+    }
+}
+
+WaveformPeaks WaveformHandler::Decode(QString f, int gen)
+{
+    WaveformPeaks peaks;
+
+    // a segment at a time, each into a temporary pcm file of its own; hours of audio never
+    //  take more than a segment's worth of disk. a short segment is the last one
+    QByteArray level, pending;
+    level.reserve(3*1024);
+    const qint64 full = qint64(WAVEFORM_SEGMENT-1)*WAVEFORM_RATE*sizeof(qint16); // allow for seek rounding
+    for(int start = 0;; start += WAVEFORM_SEGMENT)
+    {
+        qint64 bytes = DecodeSegment(f, gen, start, level, pending);
+        if(bytes < 0)
+            return peaks;
+        if(bytes < full)
+            break;
+    }
+    if(pending.size() >= int(sizeof(qint16)))
+        AppendWindow(level, (const qint16*)pending.constData(), pending.size()/sizeof(qint16));
+    if(level.isEmpty())
+        return peaks;
+
+    peaks.levels.append(level);
+    BuildLevels(peaks);
+    return peaks;
+}
+
+qint64 WaveformHandler::DecodeSegment(QString f, int gen, int start, QByteArray &level, QByteArray &pending)
+{
+    // mpv decodes into a raw pcm file which we reduce while it's being written
+    QTemporaryFile pcm(QDir::tempPath()+"/baka-waveform-XXXXXX.pcm");
+    if(!pcm.open())
+        return -1;
+    pcm.close();
+    QFile in(pcm.fileName());
+    if(!in.open(QIODevice::ReadOnly | QIODevice::Unbuffered))
+        return -1;
+
+    mpv_handle *handle = mpv_create();
+    if(!handle)
+        return -1;
+    const QByteArray tmp_pcm = pcm.fileName().toUtf8(),
+                     tmp_rate = QString::number(WAVEFORM_RATE).toUtf8(),
+                     tmp_start = QString::number(start).toUtf8(),
+                     tmp_end = QString::number(start+WAVEFORM_SEGMENT).toUtf8();
+    mpv_set_option_string(handle, "vo", "null");
+    mpv_set_option_string(handle, "vid", "no");
+    mpv_set_option_string(handle, "sid", "no");
+    mpv_set_option_string(handle, "ao", "pcm");
+    mpv_set_option_string(handle, "ao-pcm-file", tmp_pcm.constData());
+    mpv_set_option_string(handle, "ao-pcm-waveheader", "no");
+    mpv_set_option_string(handle, "audio-format", "s16");
+    mpv_set_option_string(handle, "audio-channels", "mono");
+    mpv_set_option_string(handle, "audio-samplerate", tmp_rate.constData());
+    mpv_set_option_string(handle, "start", tmp_start.constData());
+    mpv_set_option_string(handle, "end", tmp_end.constData());
+    mpv_set_option_string(handle, "hr-seek", "yes");
+    mpv_set_option_string(handle, "untimed", "yes");
+    mpv_set_option_string(handle, "replaygain", "no");
+    mpv_set_option_string(handle, "ytdl", "no");
+    mpv_set_option_string(handle, "load-scripts", "no");
+    if(mpv_initialize(handle) < 0)
+    {
+        mpv_terminate_destroy(handle);
+        return -1;
+    }
+    const QByteArray tmp_file = f.toUtf8();
+    const char *args[] = {"loadfile", tmp_file.constData(), NULL};
+    mpv_command(handle, args);
+
+    qint64 bytes = 0;
+    bool finished = false,
+         failed = false;
+    while(!finished)
+    {
+        // drain events; END_FILE means everything has been written
+        mpv_event *event = mpv_wait_event(handle, 0.05);
+        while(event->event_id != MPV_EVENT_NONE)
+        {
+            if(event->event_id == MPV_EVENT_END_FILE)
+            {
+                mpv_event_end_file *end = (mpv_event_end_file*)event->data;
+                failed = (end->reason != MPV_END_FILE_REASON_EOF);
+                finished = true;
+            }
+            else if(event->event_id == MPV_EVENT_SHUTDOWN)
+                failed = finished = true;
+            event = mpv_wait_event(handle, 0);
+        }
+
+        mutex.lock();
+        if(quit || gen != generation) // nobody wants this anymore
+            failed = finished = true;
+        mutex.unlock();
+
+        QByteArray data = in.readAll();
+        bytes += data.size();
+        pending += data;
+        const int window = WAVEFORM_WINDOW*sizeof(qint16);
+        int used = 0;
+        for(; used+window <= pending.size(); used += window)
+            AppendWindow(level, (const qint16*)(pending.constData()+used), WAVEFORM_WINDOW);
+        pending.remove(0, used);
+    }
+    mpv_terminate_destroy(handle);
+
+    if(failed)
+        return -1;
+    QByteArray data = in.readAll(); // what was written after the last read
+    bytes += data.size();
+    pending += data;
+    return bytes;
+}
+
+WaveformPeaks WaveformHandler::Load(QString peakFile)
+{
+    WaveformPeaks peaks;
+    QFile f(peakFile);
+    if(!f.open(QIODevice::ReadOnly))
+        return peaks;
+    QDataStream in(&f);
+    quint32 magic, version, rate, window, levels;
+    in >> magic >> version >> rate >> window >> levels;
+    if(in.status() != QDataStream::Ok ||
+       magic != WAVEFORM_MAGIC || version != WAVEFORM_VERSION ||
+       rate != WAVEFORM_RATE || window != WAVEFORM_WINDOW ||
+       levels == 0 || levels > WAVEFORM_MAX_LEVELS)
+        return peaks;
+    for(quint32 i = 0; i < levels; ++i)
+    {
+        quint32 count;
+        in >> count;
+        // a damaged file could claim anything; what it claims has to be there
+        if(in.status() != QDataStream::Ok || count == 0 || 3*qint64(count) > f.size()-f.pos())
+            return WaveformPeaks();
+        QByteArray level(3*count, Qt::Uninitialized);
+        if(in.readRawData(level.data(), level.size()) != level.size())
+            return WaveformPeaks(); // truncated
+        peaks.levels.append(level);
+    }
+    return peaks;
+}
+
+void WaveformHandler::Save(QString peakFile, const WaveformPeaks &peaks)
+{
+    QDir().mkpath(peakFile.section('/', 0, -2));
+    QSaveFile f(peakFile);
+    if(!f.open(QIODevice::WriteOnly))
+        return;
+    QDataStream out(&f);
+    out << quint32(WAVEFORM_MAGIC) << quint32(WAVEFORM_VERSION)
+        << quint32(WAVEFORM_RATE) << quint32(WAVEFORM_WINDOW)
+        << quint32(peaks.levels.length());
+    for(auto &level : peaks.levels)
+    {
+        out << quint32(level.size()/3);
+        out.writeRawData(level.constData(), level.size());
+    }
+    f.commit();
+}
+
+QString WaveformHandler::PeakFile(QString f)
+{
+    return QString("%0/waveforms/%1.peaks").arg(
+                QStandardPaths::writableLocation(QStandardPaths::CacheLocation),
+                Util::FileIdentity(f));
+}
@@ -0,0 +1,66 @@
+#ifndef WAVEFORMHANDLER_H
+#define WAVEFORMHANDLER_H
+
+#include <QThread>
+#include <QString>
+#include <QList>
+#include <QByteArray>
+#include <QMetaType>
+#include <QMutex>
+#include <QWaitCondition>
+
+#include <mpv/client.h>
+
+struct WaveformPeaks
+{
+    // level 0 holds one (min, max, rms) byte triplet per window of decoded audio;
+    //  every following level halves the resolution of the previous one
+    QList<QByteArray> levels;
+
+    bool isEmpty() const { return levels.isEmpty(); }
+    int count(int level) const { return levels[level].size()/3; }
+    int levelFor(int columns) const; // coarsest level that still has a window per column
+};
+Q_DECLARE_METATYPE(WaveformPeaks)
+
+class WaveformHandler : public QThread
+{
+    Q_OBJECT
+public:
+    explicit WaveformHandler(QObject *parent = 0);
+    ~WaveformHandler();
+
+    bool getEnabled() { return enabled; }
+
+public slots:
+    void setEnabled(bool b);
+    void setFile(QString f); // empty file clears the waveform
+
+signals:
+    void waveformChanged(const WaveformPeaks &peaks);
+    void decoded(int generation, const WaveformPeaks &peaks); // worker -> gui thread
+
+protected:
+    void run();
+
+    WaveformPeaks Decode(QString f, int gen);
+    qint64 DecodeSegment(QString f, int gen, int start, QByteArray &level, QByteArray &pending); // pcm bytes, -1 on failure
+    WaveformPeaks Load(QString peakFile);
+    void Save(QString peakFile, const WaveformPeaks &peaks);
+    QString PeakFile(QString f);
+
+protected slots:
+    void Insert(int generation, const WaveformPeaks &peaks);
+
+private:
+    // shared with the worker thread, guarded by mutex
+    QMutex mutex;
+    QWaitCondition condition;
+    QString file;
+    int generation = 0;
+    bool quit = false;
+
+    bool enabled = true;
+};
+
+#endif // WAVEFORMHANDLER_H
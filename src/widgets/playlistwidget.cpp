@@ -2,6 +2,7 @@
 
 #include "bakaengine.h"
 #include "mpvhandler.h"
+#include "tracing.h"
 
 #include <QListWidgetItem>
 #include <QMenu>
@@ -65,6 +66,7 @@ void PlaylistWidget::AttachEngine(BakaEngine *baka)
 
 void PlaylistWidget::Populate()
 {
+    BAKA_TRACE("PlaylistWidget::Populate");
     if(playlist.empty())
         return;
 
@@ -253,6 +255,7 @@ void PlaylistWidget::Shuffle()
 
     BoldText(file, true);
     SelectItem(item);
+    emit orderChanged(newPlaylist);
 }
 
 void PlaylistWidget::SelectItem(const QString &item)
@@ -276,10 +279,17 @@ void PlaylistWidget::RemoveFromPlaylist(QListWidgetItem *item)
     playlist.removeOne(item->text());
     delete item;
     emit currentRowChanged(currentRow());
+    QStringList items;
+    for(int i = 0; i < count(); ++i)
+        items.append(this->item(i)->text());
+    emit orderChanged(items);
 }
 
 void PlaylistWidget::DeleteFromDisk(QListWidgetItem *item)
 {
+    BAKA_TRACE("PlaylistWidget::DeleteFromDisk");
+    if(baka->replay != nullptr) // a replay never touches the user's files
+        return;
     playlist.removeOne(item->text());
     QString r = item->text().left(item->text().lastIndexOf('.')+1); // get file root (no extension)
     // check and remove all subtitle_files with the same root as the video
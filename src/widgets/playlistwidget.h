@@ -31,6 +31,9 @@ public slots:
     void ShowAll(bool);
     void Shuffle();
 
+signals:
+    void orderChanged(const QStringList &list); // items were shuffled or removed
+
 protected slots:
     void BoldText(const QString &f, bool state);
     void RemoveFromPlaylist(QListWidgetItem *item);
@@ -6,13 +6,34 @@
 #include <QRect>
 #include <QStyle>
 
+#include <algorithm> // for std::min and std::max
+
 #include "util.h"
 
 SeekBar::SeekBar(QWidget *parent):
     CustomSlider(parent),
     tickReady(false),
-    totalTime(0)
+    totalTime(0),
+    preview(nullptr)
+{
+    waveformLayer = addLayer([=](QPainter &painter) { paintWaveform(painter); });
+    bufferedLayer = addLayer([=](QPainter &painter) { paintBufferedRanges(painter); });
+    tickLayer = addLayer([=](QPainter &painter) { paintTicks(painter); });
+}
+
+int SeekBar::addLayer(LayerPainter painter)
 {
+    layers.append(Layer{painter, QPixmap(), true});
+    return layers.length()-1;
+}
+
+void SeekBar::invalidateLayer(int layer)
+{
+    if(layer >= 0 && layer < layers.length())
+    {
+        layers[layer].dirty = true;
+        update();
+    }
 }
 
 void SeekBar::setTracking(int _totalTime)
@@ -27,43 +48,173 @@ void SeekBar::setTracking(int _totalTime)
         if(ticks.length() > 0)
         {
             tickReady = true; // ticks are ready to be displayed
-            repaint(rect());
+            invalidateLayer(tickLayer);
         }
+        invalidateLayer(bufferedLayer); // ranges are relative to the length
         setMouseTracking(true);
     }
     else
+    {
         setMouseTracking(false);
+        if(preview != nullptr)
+            preview->hide();
+    }
 }
 
 void SeekBar::setTicks(QList<int> values)
 {
     ticks = values; // just set the values
     tickReady = false; // ticks need to be converted when totalTime is obtained
+    invalidateLayer(tickLayer);
+}
+
+void SeekBar::setWaveform(const WaveformPeaks &peaks)
+{
+    waveform = peaks;
+    invalidateLayer(waveformLayer);
+}
+
+void SeekBar::setBufferedRanges(const QList<QPair<double, double>> &ranges)
+{
+    if(buffered == ranges)
+        return;
+    buffered = ranges;
+    invalidateLayer(bufferedLayer);
+}
+
+void SeekBar::setPreview(const QImage &image)
+{
+    if(totalTime == 0 || !underMouse())
+        return;
+    if(preview == nullptr)
+    {
+        preview = new QLabel(this, Qt::ToolTip);
+        preview->setAttribute(Qt::WA_TransparentForMouseEvents);
+    }
+    preview->setPixmap(QPixmap::fromImage(image));
+    preview->resize(image.size());
+    // centered above the time tooltip
+    preview->move(previewPos.x()-image.width()/2, previewPos.y()-image.height()-4);
+    preview->show();
 }
 
 void SeekBar::mouseMoveEvent(QMouseEvent* event)
 {
     if(totalTime != 0)
     {
-        QToolTip::showText(QPoint(event->globalX()-25, mapToGlobal(rect().topLeft()).y()-40),
-                           Util::FormatTime(QStyle::sliderValueFromPosition(minimum(), maximum(), event->x(), width())*(double)totalTime/maximum(), totalTime),
+        int time = QStyle::sliderValueFromPosition(minimum(), maximum(), event->x(), width())*(double)totalTime/maximum();
+        previewPos = QPoint(event->globalX(), mapToGlobal(rect().topLeft()).y()-40);
+        QToolTip::showText(QPoint(event->globalX()-25, previewPos.y()),
+                           Util::FormatTime(time, totalTime),
                            this, rect());
+        if(preview != nullptr && preview->isVisible()) // follow the cursor until the new thumbnail arrives
+            preview->move(previewPos.x()-preview->width()/2, preview->y());
+        emit previewRequested(time);
     }
     QSlider::mouseMoveEvent(event);
 }
 
+void SeekBar::leaveEvent(QEvent *event)
+{
+    if(preview != nullptr)
+        preview->hide();
+    QSlider::leaveEvent(event);
+}
+
 void SeekBar::paintEvent(QPaintEvent *event)
 {
     CustomSlider::paintEvent(event);
-    if(isEnabled() && tickReady)
+    if(!isEnabled())
+        return;
+
+    // the seekbar repaints on every time update; the layers only get redrawn when invalidated
+    QPainter painter(this);
+    const qreal ratio = devicePixelRatio();
+    for(auto &layer : layers)
     {
-        QRect region = event->rect();
-        QPainter painter(this);
-        painter.setPen(QColor(190,190,190));
-        for(auto &tick : ticks)
+        if(layer.dirty || layer.pixmap.size() != size()*ratio)
+        {
+            layer.pixmap = QPixmap(size()*ratio);
+            layer.pixmap.setDevicePixelRatio(ratio);
+            layer.pixmap.fill(Qt::transparent);
+            QPainter layerPainter(&layer.pixmap);
+            layer.paint(layerPainter);
+            layer.dirty = false;
+        }
+        painter.drawPixmap(0, 0, layer.pixmap);
+    }
+}
+
+void SeekBar::resizeEvent(QResizeEvent *event)
+{
+    for(auto &layer : layers)
+        layer.dirty = true;
+    CustomSlider::resizeEvent(event);
+}
+
+void SeekBar::changeEvent(QEvent *event)
+{
+    if(event->type() == QEvent::StyleChange ||
+       event->type() == QEvent::PaletteChange)
+    {
+        for(auto &layer : layers)
+            layer.dirty = true;
+    }
+    CustomSlider::changeEvent(event);
+}
+
+void SeekBar::paintTicks(QPainter &painter)
+{
+    if(!tickReady)
+        return;
+    painter.setPen(QColor(190,190,190));
+    for(auto &tick : ticks)
+    {
+        int x = QStyle::sliderPositionFromValue(minimum(), maximum(), tick, width());
+        painter.drawLine(x, 0, x, height());
+    }
+}
+
+void SeekBar::paintWaveform(QPainter &painter)
+{
+    if(waveform.isEmpty() || width() <= 0)
+        return;
+    // pick the mip level matching our width so resizing never needs the audio again
+    const int level = waveform.levelFor(width()),
+              count = waveform.count(level);
+    const char *data = waveform.levels[level].constData();
+    const double mid = height()/2.0;
+    QColor peak(120,120,120,110),
+           rms(90,90,90,160);
+    for(int x = 0; x < width(); ++x)
+    {
+        int first = qint64(x)*count/width(),
+            last = std::max(first+1, int(qint64(x+1)*count/width()));
+        int lo = 127, hi = -128, r = 0;
+        for(int i = first; i < last && i < count; ++i)
         {
-            int x = QStyle::sliderPositionFromValue(minimum(), maximum(), tick, width());
-            painter.drawLine(x, region.top(), x, region.bottom());
+            lo = std::min(lo, int(data[3*i]));
+            hi = std::max(hi, int(data[3*i+1]));
+            r = std::max(r, int(quint8(data[3*i+2])));
         }
+        if(lo > hi)
+            continue;
+        painter.setPen(peak);
+        painter.drawLine(QLineF(x, mid - hi*mid/128, x, mid - lo*mid/128));
+        painter.setPen(rms);
+        painter.drawLine(QLineF(x, mid - r*mid/128, x, mid + r*mid/128));
+    }
+}
+
+void SeekBar::paintBufferedRanges(QPainter &painter)
+{
+    if(buffered.isEmpty() || totalTime == 0)
+        return;
+    const int h = std::max(2, height()/5);
+    for(auto &range : buffered)
+    {
+        int x1 = QStyle::sliderPositionFromValue(minimum(), maximum(), int(range.first/totalTime*maximum()), width()),
+            x2 = QStyle::sliderPositionFromValue(minimum(), maximum(), int(std::min(range.second, double(totalTime))/totalTime*maximum()), width());
+        painter.fillRect(x1, (height()-h)/2, std::max(1, x2-x1), h, QColor(150,150,150,120));
     }
 }
@@ -4,8 +4,16 @@
 #include <QMouseEvent>
 #include <QPaintEvent>
 #include <QList>
+#include <QPair>
+#include <QImage>
+#include <QLabel>
+#include <QPixmap>
+#include <QPainter>
+
+#include <functional>
 
 #include "customslider.h"
+#include "waveformhandler.h"
 
 class SeekBar : public CustomSlider
 {
@@ -13,20 +21,55 @@ class SeekBar : public CustomSlider
 public:
     explicit SeekBar(QWidget *parent = 0);
 
+    // static overlays (chapter ticks, buffered ranges, markers...) are painted once into a
+    //  cached pixmap and only repainted after invalidateLayer, a resize or a style change
+    typedef std::function<void(QPainter&)> LayerPainter;
+    int addLayer(LayerPainter painter);
+
 public slots:
+    void invalidateLayer(int layer);
+
     void setTracking(int _totalTime);
     void setTicks(QList<int> values);
+    void setPreview(const QImage &image);
+    void setWaveform(const WaveformPeaks &peaks);
+    void setBufferedRanges(const QList<QPair<double, double>> &ranges);
+
+signals:
+    void previewRequested(int time);
 
 protected:
     QString formatTrackingTime(int _time);
 
     void mouseMoveEvent(QMouseEvent* event);
+    void leaveEvent(QEvent *event);
     void paintEvent(QPaintEvent *event);
+    void resizeEvent(QResizeEvent *event);
+    void changeEvent(QEvent *event);
+
+    void paintTicks(QPainter &painter);
+    void paintWaveform(QPainter &painter);
+    void paintBufferedRanges(QPainter &painter);
 
 private:
+    struct Layer
+    {
+        LayerPainter paint;
+        QPixmap pixmap;
+        bool dirty;
+    };
+    QList<Layer> layers;
+    int tickLayer,
+        waveformLayer,
+        bufferedLayer;
+    WaveformPeaks waveform;
+    QList<QPair<double, double>> buffered;
+
     QList<int> ticks;
     bool tickReady;
     int totalTime;
+    QLabel *preview;
+    QPoint previewPos;
 };
 
 #endif // SEEKBAR_H